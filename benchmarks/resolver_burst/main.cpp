@@ -0,0 +1,114 @@
+// Burst name lookups through io_service against a stub resolver, with and without the resolver pool
+// (YOPT_S_DNS_RESOLV_THREADS).
+//
+// Every channel of a fresh io_service is opened at once to one of a few hosts. The stub resolver
+// sleeps to simulate a slow lookup and answers 127.0.0.1 on a closed port, so each channel ends with
+// a quick connection refused. A run is timed from the burst until every channel reported YEK_ON_OPEN.
+//
+// usage: resolver_burst [channels=64] [hosts=8] [lookupMs=5] [rounds=5]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "yasio.hpp"
+
+using namespace yasio;
+
+struct RunResult
+{
+    double elapsedMs = 0;
+    int lookups      = 0;  // resolver calls, fewer than channels when identical queries are merged
+    int threads      = 0;  // distinct threads the resolver was called on
+};
+
+static RunResult runBurst(int resolvThreads, int channels, int hosts, int lookupMs)
+{
+    std::atomic<int> lookups{0};
+    std::mutex threadsMutex;
+    std::set<std::thread::id> threads;
+
+    std::mutex doneMutex;
+    std::condition_variable doneCond;
+    int opened = 0;
+
+    io_service service(channels);
+    print_fn2_t quiet = [](int, const char*) {};  // every connect fails on purpose
+    service.set_option(YOPT_S_PRINT_FN2, &quiet);
+    service.set_option(YOPT_S_DNS_RESOLV_THREADS, resolvThreads);
+    resolv_fn_t resolver = [&](std::vector<ip::endpoint>& eps, const char*, unsigned short port) {
+        ++lookups;
+        {
+            std::lock_guard<std::mutex> lck(threadsMutex);
+            threads.insert(std::this_thread::get_id());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(lookupMs));
+        eps.emplace_back("127.0.0.1", port);
+        return 0;
+    };
+    service.set_option(YOPT_S_RESOLV_FN, &resolver);
+
+    for (int i = 0; i < channels; ++i)
+    {
+        auto host = "host" + std::to_string(i % hosts) + ".test";
+        service.set_option(YOPT_C_REMOTE_ENDPOINT, i, host.c_str(), 1);  // nothing listens on port 1
+    }
+
+    service.start([&](event_ptr&& event) {
+        if (event->kind() != YEK_ON_OPEN)
+            return;
+        std::lock_guard<std::mutex> lck(doneMutex);
+        if (++opened == channels)
+            doneCond.notify_one();
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < channels; ++i)
+        service.open(i, YCK_TCP_CLIENT);
+
+    RunResult result;
+    {
+        std::unique_lock<std::mutex> lck(doneMutex);
+        if (!doneCond.wait_for(lck, std::chrono::seconds(30), [&] { return opened == channels; }))
+            fprintf(stderr, "timeout, %d of %d channels done\n", opened, channels);
+    }
+    result.elapsedMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    service.stop();
+
+    result.lookups = lookups;
+    std::lock_guard<std::mutex> lck(threadsMutex);
+    result.threads = static_cast<int>(threads.size());
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int channels = argc > 1 ? atoi(argv[1]) : 64;
+    int hosts    = argc > 2 ? atoi(argv[2]) : 8;
+    int lookupMs = argc > 3 ? atoi(argv[3]) : 5;
+    int rounds   = argc > 4 ? atoi(argv[4]) : 5;
+
+    printf("%d channels, %d hosts, %dms per lookup, %d rounds\n", channels, hosts, lookupMs, rounds);
+    printf("%-16s %12s %10s %10s\n", "resolv threads", "avg ms", "lookups", "threads");
+    for (int resolvThreads : {0, 1, 2, 4})
+    {
+        RunResult total;
+        for (int round = 0; round < rounds; ++round)
+        {
+            auto result = runBurst(resolvThreads, channels, hosts, lookupMs);
+            total.elapsedMs += result.elapsedMs;
+            total.lookups += result.lookups;
+            total.threads += result.threads;
+        }
+        printf("%-16s %12.2f %10.1f %10.1f\n", resolvThreads ? std::to_string(resolvThreads).c_str() : "0 (per query)",
+               total.elapsedMs / rounds, total.lookups / double(rounds), total.threads / double(rounds));
+    }
+    return 0;
+}
@@ -209,6 +209,10 @@ SOFTWARE.
 // The max internet buffer size
 #define YASIO_INET_BUFFER_SIZE 65536
 
+// The max receive buffers of each size class kept by io_service for reuse, the transport
+// receive buffer starts at YASIO_INET_BUFFER_SIZE/16 and grows x4 when a read fills it
+#define YASIO_INET_BUFFER_POOL_SIZE 8
+
 // The max pdu buffer length, avoid large memory allocation when application decode a huge length.
 #define YASIO_MAX_PDU_BUFFER_SIZE static_cast<int>(1 * 1024 * 1024)
 
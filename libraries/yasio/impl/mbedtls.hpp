@@ -254,6 +254,34 @@ YASIO__DECL int yssl_read(yssl_st* ssl, void* data, size_t len, int& err)
   return n;
 }
 
+YASIO__DECL std::string yssl_get_session(yssl_st* ssl)
+{
+  std::string data;
+  mbedtls_ssl_session session;
+  ::mbedtls_ssl_session_init(&session);
+  if (::mbedtls_ssl_get_session(ssl, &session) == 0)
+  {
+    size_t len = 0;
+    ::mbedtls_ssl_session_save(&session, nullptr, 0, &len);
+    data.resize(len);
+    if (len == 0 || ::mbedtls_ssl_session_save(&session, reinterpret_cast<unsigned char*>(&data.front()), len, &len) != 0)
+      data.clear();
+  }
+  ::mbedtls_ssl_session_free(&session);
+  return data;
+}
+YASIO__DECL bool yssl_set_session(yssl_st* ssl, const void* data, size_t len)
+{
+  mbedtls_ssl_session session;
+  ::mbedtls_ssl_session_init(&session);
+  bool ok = ::mbedtls_ssl_session_load(&session, static_cast<const unsigned char*>(data), len) == 0 && ::mbedtls_ssl_set_session(ssl, &session) == 0;
+  ::mbedtls_ssl_session_free(&session);
+  return ok;
+}
+YASIO__DECL bool yssl_session_reused(yssl_st* /*ssl*/)
+{
+  return false; // mbedtls doesn't tell after the handshake
+}
 #endif
 
 #endif
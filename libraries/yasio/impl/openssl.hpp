@@ -85,6 +85,9 @@ YASIO__DECL yssl_ctx_st* yssl_ctx_new(const yssl_options& opts)
     }
     else
       ::SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+
+    // sessions are cached by the user, see yssl_get_session
+    ::SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
   }
   else
   {
@@ -292,6 +295,37 @@ YASIO__DECL int yssl_read(yssl_st* ssl, void* data, size_t len, int& err)
   }
   return -1;
 }
+YASIO__DECL std::string yssl_get_session(yssl_st* ssl)
+{
+  std::string data;
+  auto session = ::SSL_get_session(yssl_unwrap(ssl));
+#  if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  if (!session || !::SSL_SESSION_is_resumable(session))
+    return data;
+#  else
+  if (!session)
+    return data;
+#  endif
+  int len = ::i2d_SSL_SESSION(session, nullptr);
+  if (len > 0)
+  {
+    data.resize(len);
+    auto p = reinterpret_cast<unsigned char*>(&data.front());
+    ::i2d_SSL_SESSION(session, &p);
+  }
+  return data;
+}
+YASIO__DECL bool yssl_set_session(yssl_st* ssl, const void* data, size_t len)
+{
+  auto p       = static_cast<const unsigned char*>(data);
+  auto session = ::d2i_SSL_SESSION(nullptr, &p, static_cast<long>(len));
+  if (!session)
+    return false;
+  bool ok = ::SSL_set_session(yssl_unwrap(ssl), session) == 1;
+  ::SSL_SESSION_free(session);
+  return ok;
+}
+YASIO__DECL bool yssl_session_reused(yssl_st* ssl) { return ::SSL_session_reused(yssl_unwrap(ssl)) == 1; }
 #endif
 
 #endif
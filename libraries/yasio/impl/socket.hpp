@@ -75,6 +75,7 @@ typedef int socklen_t;
 #  endif
 #  include <sys/select.h>
 #  include <sys/socket.h>
+#  include <sys/uio.h>
 #  include <sys/un.h>
 #  include <netinet/in.h>
 #  include <netinet/tcp.h>
@@ -236,6 +237,7 @@ inline bool IN6_IS_ADDR_GLOBAL(const in6_addr* a)
 
 namespace yasio
 {
+YASIO__NS_INLINE
 namespace inet
 {
 struct socket_event {
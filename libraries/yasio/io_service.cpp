@@ -209,6 +209,48 @@ std::chrono::microseconds highp_timer::wait_duration() const
 /// io_send_op
 int io_send_op::perform(io_transport* transport, const void* buf, int n, int& error) { return transport->write_cb_(buf, n, nullptr, error); }
 
+/// io_send_gather_op
+static size_t io_send_buffers_size(const std::vector<io_send_buffer>& buffers)
+{
+  size_t size = 0;
+  for (auto& buffer : buffers)
+    size += buffer.size();
+  return size;
+}
+io_send_gather_op::io_send_gather_op(std::vector<io_send_buffer>&& buffers, completion_cb_t&& handler)
+    : io_send_op(io_send_buffer{nullptr, io_send_buffers_size(buffers)}, std::move(handler)), buffers_(std::move(buffers))
+{}
+int io_send_gather_op::perform_remain(transport_handle_t transport, int& error)
+{
+  enum
+  {
+    max_iovecs = 16
+  };
+  iovec_t iovecs[max_iovecs];
+  int count     = 0;
+  size_t offset = offset_;
+  for (auto& buffer : buffers_)
+  {
+    if (offset >= buffer.size())
+    { // already sent
+      offset -= buffer.size();
+      continue;
+    }
+    if (yasio__testbits(transport->ctx_->properties_, YCM_SSL))
+    { // no gather write for ssl, send the current buffer only
+      return transport->write_cb_(buffer.data() + offset, static_cast<int>(buffer.size() - offset), nullptr, error);
+    }
+    iovec_set(iovecs[count], buffer.data() + offset, buffer.size() - offset);
+    offset = 0;
+    if (++count == max_iovecs)
+      break;
+  }
+  int n = xxsocket::sendv(transport->socket_->native_handle(), iovecs, count, YASIO_MSG_FLAG);
+  if (n < 0)
+    error = xxsocket::get_last_errno();
+  return n;
+}
+
 /// io_sendto_op
 int io_sendto_op::perform(io_transport* transport, const void* buf, int n, int& error)
 {
@@ -216,7 +258,7 @@ int io_sendto_op::perform(io_transport* transport, const void* buf, int n, int&
 }
 
 /// io_channel
-io_channel::io_channel(io_service& service, int index) : io_base(), service_(service), timer_(service), user_timer_(service)
+io_channel::io_channel(io_service& service, int index) : io_base(), service_(service), timer_(service), attempt_timer_(service), user_timer_(service)
 {
   socket_     = std::make_shared<xxsocket>();
   state_      = io_base::state::CLOSED;
@@ -371,7 +413,47 @@ int io_transport::write(io_send_buffer&& buffer, completion_cb_t&& handler)
   get_service().wakeup();
   return n;
 }
-int io_transport::do_read(int revent, int& error, highp_time_t&) { return this->call_read(buffer_ + offset_, sizeof(buffer_) - offset_, revent, error); }
+int io_transport::do_read(int revent, int& error, highp_time_t&)
+{
+  if (!buffer_ || (buffer_full_ && buffer_size_ < YASIO_INET_BUFFER_SIZE))
+    grow_buffer(buffer_size_);
+  int space    = buffer_size_ - offset_;
+  int n        = this->call_read(buffer_ + offset_, space, revent, error);
+  buffer_full_ = (n == space);
+  return n;
+}
+void io_transport::grow_buffer(int min_size)
+{
+  auto& service = get_service();
+  int size      = min_size;
+  auto buf      = service.acquire_buffer(size);
+  if (buffer_)
+  {
+    if (offset_ > 0)
+      ::memcpy(buf, buffer_, offset_);
+    service.release_buffer(buffer_, buffer_size_);
+  }
+  buffer_      = buf;
+  buffer_size_ = size;
+}
+void io_transport::release_buffer()
+{
+  if (buffer_)
+  {
+    get_service().release_buffer(buffer_, buffer_size_);
+    buffer_      = nullptr;
+    buffer_size_ = 0;
+  }
+}
+int io_transport::writev(std::vector<io_send_buffer>&& buffers, completion_cb_t&& handler)
+{
+  auto op = cxx14::make_unique<io_send_gather_op>(std::move(buffers), std::move(handler));
+  int n   = static_cast<int>(op->buffer_.size());
+  send_queue_.emplace(std::move(op));
+  get_service().wakeup();
+  return n;
+}
+
 bool io_transport::do_write(highp_time_t& wait_duration)
 {
   bool ret = false;
@@ -440,7 +522,7 @@ int io_transport::call_read(void* data, int size, int revent, int& error)
 }
 int io_transport::call_write(io_send_op* op, int& error)
 {
-  int n = op->perform(this, op->buffer_.data() + op->offset_, static_cast<int>(op->buffer_.size() - op->offset_), error);
+  int n = op->perform_remain(this, error);
   if (n > 0)
   {
     // #performance: change offset only, remain data will be send at next frame.
@@ -498,6 +580,14 @@ io_transport_ssl::io_transport_ssl(io_channel* ctx, xxsocket_ptr&& sock) : io_tr
   this->state_ = io_base::state::CONNECTING; // for ssl, inital state shoud be connecing for ssl handshake
   bool client  = yasio__testbits(ctx->properties_, YCM_CLIENT);
   this->ssl_   = yssl_new(ctx->get_ssl_context(client), static_cast<int>(this->socket_->native_handle()), ctx->remote_host_.c_str(), client);
+
+  auto& load_session = get_service().options_.ssl_session_load_;
+  if (client && load_session)
+  {
+    auto session = load_session(ctx->remote_host_.c_str());
+    if (!session.empty())
+      yssl_set_session(ssl_, session.data(), session.size());
+  }
 }
 int io_transport_ssl::do_ssl_handshake(int& error)
 {
@@ -513,6 +603,9 @@ int io_transport_ssl::do_ssl_handshake(int& error)
     };
     this->write_cb_ = [this](const void* data, int len, const ip::endpoint*, int& error) { return yssl_write(ssl_, data, len, error); };
 
+    this->session_reused_ = yssl_session_reused(ssl_);
+    save_ssl_session();
+
     YASIO_KLOGD("[index: %d] the connection #%u <%s> --> <%s> is established.", ctx_->index_, this->id_, this->local_endpoint().to_string().c_str(),
                 this->remote_endpoint().to_string().c_str());
     get_service().fire_event(ctx_->index_, YEK_ON_OPEN, 0, this);
@@ -540,7 +633,21 @@ int io_transport_ssl::do_ssl_handshake(int& error)
 void io_transport_ssl::do_ssl_shutdown()
 {
   if (ssl_)
+  {
+    if (this->state_ == io_base::state::OPENED)
+      save_ssl_session(); // pick up the tickets received after the handshake
     yssl_shutdown(ssl_, this->error_ == yasio::errc::shutdown_by_localhost);
+  }
+}
+void io_transport_ssl::save_ssl_session()
+{
+  auto& save_session = get_service().options_.ssl_session_save_;
+  if (save_session && yasio__testbits(ctx_->properties_, YCM_CLIENT))
+  {
+    auto session = yssl_get_session(ssl_);
+    if (!session.empty())
+      save_session(ctx_->remote_host_.c_str(), std::move(session));
+  }
 }
 void io_transport_ssl::set_primitives()
 {
@@ -687,7 +794,9 @@ int io_transport_kcp::do_read(int revent, int& error, highp_time_t& wait_duratio
     this->handle_input(rawbuf_.data(), n, error, wait_duration);
   if (!error)
   { // !important, should always try to call ikcp_recv when no error occured.
-    n = ::ikcp_recv(kcp_, buffer_ + offset_, sizeof(buffer_) - offset_);
+    if (buffer_size_ < YASIO_INET_BUFFER_SIZE) // a kcp message must fit at once
+      grow_buffer(YASIO_INET_BUFFER_SIZE - 1);
+    n = ::ikcp_recv(kcp_, buffer_ + offset_, buffer_size_ - offset_);
     if (n > 0) // If got data from kcp, don't wait
       wait_duration = 0;
     else if (n < 0)
@@ -776,6 +885,15 @@ void io_transport_kcp::check_timeout(highp_time_t& wait_duration) const
 void io_service::init_globals(const yasio::inet::print_fn2_t& prt) { yasio__shared_globals(prt).cprint_ = prt; }
 void io_service::cleanup_globals() { yasio__shared_globals().cprint_ = nullptr; }
 unsigned int io_service::tcp_rtt(transport_handle_t transport) { return transport->is_open() ? transport->socket_->tcp_rtt() : 0; }
+bool io_service::ssl_session_reused(transport_handle_t transport)
+{
+#if defined(YASIO_SSL_BACKEND)
+  if (yasio__testbits(transport->ctx_->properties_, YCM_SSL))
+    return static_cast<io_transport_ssl*>(transport)->session_reused();
+#endif
+  YASIO__UNUSED_PARAM(transport);
+  return false;
+}
 io_service::io_service() { this->initialize(nullptr, 1); }
 io_service::io_service(int channel_count) { this->initialize(nullptr, channel_count); }
 io_service::io_service(const io_hostent& channel_ep) { this->initialize(&channel_ep, 1); }
@@ -875,8 +993,9 @@ void io_service::initialize(const io_hostent* channel_eps, int channel_count)
   create_channels(channel_eps, channel_count);
 
 #if !defined(YASIO_USE_CARES)
-  life_mutex_ = std::make_shared<cxx17::shared_mutex>();
-  life_token_ = std::make_shared<life_token>();
+  life_mutex_  = std::make_shared<cxx17::shared_mutex>();
+  life_token_  = std::make_shared<life_token>();
+  resolv_pool_ = std::make_shared<resolv_pool>(); // never replaced, post_query may run on any thread
 #endif
   this->state_ = io_service::state::IDLE;
 }
@@ -885,6 +1004,15 @@ void io_service::finalize()
   if (this->state_ == io_service::state::IDLE)
   {
 #if !defined(YASIO_USE_CARES)
+    {
+      // drop the queued queries and wait for the ones in flight, the resolver function may capture
+      // objects which are destroyed with the service, they complete before the life token is reset
+      std::unique_lock<std::mutex> pool_lck(resolv_pool_->mtx);
+      resolv_pool_->stopped = true;
+      resolv_pool_->queue.clear();
+      resolv_pool_->cv.notify_all();
+      resolv_pool_->drained_cv.wait(pool_lck, [this] { return resolv_pool_->busy == 0; });
+    }
     std::unique_lock<cxx17::shared_mutex> lck(*life_mutex_);
     life_token_.reset();
 #endif
@@ -897,6 +1025,13 @@ void io_service::finalize()
       ::operator delete(o);
     tpool_.clear();
 
+    for (auto& pool : buffer_pool_)
+    {
+      for (auto buf : pool)
+        delete[] buf;
+      pool.clear();
+    }
+
     this->state_ = io_service::state::UNINITIALIZED;
   }
 }
@@ -1120,19 +1255,36 @@ bool io_service::is_open(int index) const
 }
 bool io_service::open(size_t index, int kind)
 {
-  assert((kind > 0 && kind <= 0xff) && ((kind & (kind - 1)) != 0));
   auto ctx = channel_at(index);
   if (ctx != nullptr)
   {
-    yasio__setlobyte(ctx->properties_, kind & 0xff);
-    if (yasio__testbits(kind, YCM_TCP))
-      ctx->socktype_ = SOCK_STREAM;
-    else if (yasio__testbits(kind, YCM_UDP))
-      ctx->socktype_ = SOCK_DGRAM;
+    set_channel_kind(ctx, kind);
     return open_internal(ctx);
   }
   return false;
 }
+int io_service::open(const std::pair<int, int>* channels, size_t count)
+{
+  int opened = 0;
+  {
+    std::lock_guard<std::recursive_mutex> lck(this->channel_ops_mtx_);
+    for (size_t i = 0; i < count; ++i)
+    {
+      auto ctx = channel_at(channels[i].first);
+      if (ctx == nullptr)
+        continue;
+      set_channel_kind(ctx, channels[i].second);
+      if (!prepare_open(ctx))
+        continue;
+      if (yasio__find(this->channel_ops_, ctx) == this->channel_ops_.end())
+        this->channel_ops_.push_back(ctx);
+      ++opened;
+    }
+  }
+  if (opened)
+    this->wakeup();
+  return opened;
+}
 io_channel* io_service::channel_at(size_t index) const { return (index < channels_.size()) ? channels_[index] : nullptr; }
 void io_service::handle_close(transport_handle_t thandle)
 {
@@ -1190,6 +1342,16 @@ int io_service::write_to(transport_handle_t transport, sbyte_buffer buffer, cons
     return -1;
   }
 }
+int io_service::writev(transport_handle_t transport, std::vector<io_send_buffer> buffers, completion_cb_t handler)
+{
+  if (transport && transport->is_open() && yasio__testbits(transport->ctx_->properties_, YCM_TCP))
+    return !buffers.empty() ? transport->writev(std::move(buffers), std::move(handler)) : 0;
+  else
+  {
+    YASIO_KLOGE("writev failed, the connection not ok!");
+    return -1;
+  }
+}
 int io_service::forward_to(transport_handle_t transport, const void* buf, size_t len, const ip::endpoint& to, completion_cb_t handler)
 {
   if (transport && transport->is_open())
@@ -1207,79 +1369,216 @@ void io_service::do_connect(io_channel* ctx)
     this->ipsv_ = static_cast<u_short>(xxsocket::getipsv());
   if (ctx->socket_->is_open())
     cleanup_io(ctx);
+  cancel_attempts(ctx);
 
   ctx->state_ = io_base::state::CONNECTING;
-  auto& ep    = ctx->remote_eps_[0];
+  if (options_.connect_attempt_delay_ > 0 && ctx->remote_eps_.size() > 1 && yasio__testbits(ctx->properties_, YCM_TCP))
+  {
+    interleave_remote_eps(ctx);
+    ctx->next_attempt_ = 1;
+  }
+  else
+    ctx->next_attempt_ = ctx->remote_eps_.size(); // no racing
+
+  int error = connect_attempt(ctx, ctx->socket_, ctx->remote_eps_[0]);
+  if (error == 0)
+  { // connect server successful immediately, for udp do not need to connect.
+    handle_connect_succeed(ctx, ctx->socket_);
+    return;
+  }
+  if (error != EINPROGRESS && ctx->next_attempt_ >= ctx->remote_eps_.size())
+  {
+    this->handle_connect_failed(ctx, error);
+    return;
+  }
+
+  // setup non-blocking connect
+  ctx->set_last_errno(EINPROGRESS);
+  ctx->timer_.expires_from_now(std::chrono::microseconds(options_.connect_timeout_));
+  ctx->timer_.async_wait_once([ctx](io_service& thiz) {
+    if (ctx->state_ != io_base::state::OPENED)
+      thiz.handle_connect_failed(ctx, ETIMEDOUT);
+  });
+  if (error != EINPROGRESS)
+    continue_attempts(ctx, error);
+  else if (ctx->next_attempt_ < ctx->remote_eps_.size())
+  {
+    ctx->attempt_timer_.expires_from_now(std::chrono::microseconds(options_.connect_attempt_delay_));
+    ctx->attempt_timer_.async_wait_once([ctx](io_service& thiz) {
+      if (ctx->state_ == io_base::state::CONNECTING)
+        thiz.continue_attempts(ctx, ETIMEDOUT);
+    });
+  }
+}
+
+void io_service::do_connect_completion(io_channel* ctx)
+{
+  assert(ctx->state_ == io_base::state::CONNECTING);
+  if (ctx->state_ == io_base::state::CONNECTING)
+  {
+    int error = -1;
+    if (ctx->socket_->is_open() && io_watcher_.is_ready(ctx->socket_->native_handle(), socket_event::readwrite))
+    {
+      if (ctx->socket_->get_optval(SOL_SOCKET, SO_ERROR, error) >= 0 && error == 0)
+      {
+        handle_attempt_succeed(ctx, ctx->socket_);
+        return;
+      }
+      io_watcher_.mod_event(ctx->socket_->native_handle(), 0, socket_event::readwrite);
+      ctx->socket_->close();
+      continue_attempts(ctx, error);
+    }
+
+    for (size_t i = 0; i < ctx->racing_sockets_.size() && ctx->state_ == io_base::state::CONNECTING;)
+    {
+      auto s = ctx->racing_sockets_[i];
+      if (io_watcher_.is_ready(s->native_handle(), socket_event::readwrite))
+      {
+        error = -1;
+        if (s->get_optval(SOL_SOCKET, SO_ERROR, error) >= 0 && error == 0)
+        {
+          handle_attempt_succeed(ctx, std::move(s));
+          return;
+        }
+        io_watcher_.mod_event(s->native_handle(), 0, socket_event::readwrite);
+        s->close();
+        ctx->racing_sockets_.erase(ctx->racing_sockets_.begin() + i);
+        continue_attempts(ctx, error);
+      }
+      else
+        ++i;
+    }
+  }
+}
+int io_service::connect_attempt(io_channel* ctx, xxsocket_ptr& s, const ip::endpoint& ep)
+{
   YASIO_KLOGD("[index: %d] connecting server %s(%s):%u...", ctx->index_, ctx->remote_host_.c_str(), ep.ip().c_str(), ctx->remote_port_);
-  if (ctx->socket_->popen(ep.af(), ctx->socktype_))
+  if (!s->popen(ep.af(), ctx->socktype_))
+    return xxsocket::get_last_errno();
+
+  int ret = 0;
+  if (yasio__testbits(ctx->properties_, YCF_REUSEADDR))
+    s->reuse_address(true);
+  if (yasio__testbits(ctx->properties_, YCF_EXCLUSIVEADDRUSE))
+    s->exclusive_address(true);
+
+  if (!yasio__testbits(ctx->properties_, YCM_UDS))
   {
-    int ret = 0;
-    if (yasio__testbits(ctx->properties_, YCF_REUSEADDR))
-      ctx->socket_->reuse_address(true);
-    if (yasio__testbits(ctx->properties_, YCF_EXCLUSIVEADDRUSE))
-      ctx->socket_->exclusive_address(true);
+    auto ifaddr = ctx->local_host_.empty() ? YASIO_ADDR_ANY(ep.af()) : ctx->local_host_.c_str();
+    ret         = s->bind(ifaddr, ctx->local_port_);
+  }
 
-    if (!yasio__testbits(ctx->properties_, YCM_UDS))
+  if (ret == 0)
+  {
+    // tcp connect directly, for udp do not need to connect.
+    if (yasio__testbits(ctx->properties_, YCM_TCP))
+      ret = xxsocket::connect(s->native_handle(), ep);
+    // join the multicast group for udp
+    if (yasio__testbits(ctx->properties_, YCPF_MCAST))
+      ctx->join_multicast_group();
+  }
+
+  if (ret < 0)
+  {
+    int error = xxsocket::get_last_errno();
+    if (error != EINPROGRESS && error != EWOULDBLOCK)
     {
-      auto ifaddr = ctx->local_host_.empty() ? YASIO_ADDR_ANY(ep.af()) : ctx->local_host_.c_str();
-      ret         = ctx->socket_->bind(ifaddr, ctx->local_port_);
+      s->close();
+      return error;
     }
+    io_watcher_.mod_event(s->native_handle(), socket_event::readwrite, 0);
+    return EINPROGRESS;
+  }
+  io_watcher_.mod_event(s->native_handle(), socket_event::read, 0);
+  return 0;
+}
+void io_service::interleave_remote_eps(io_channel* ctx)
+{
+  auto& eps    = ctx->remote_eps_;
+  int first_af = last_connected_af_;
+  if (first_af == 0)
+    first_af = eps[0].af();
+  auto is_first = [first_af](const ip::endpoint& ep) { return ep.af() == first_af; };
+  std::stable_partition(eps.begin(), eps.end(), is_first);
 
+  // first, second, first, second...
+  auto second = std::find_if_not(eps.begin(), eps.end(), is_first);
+  for (auto it = eps.begin(); it != second && second != eps.end(); ++second)
+  {
+    ++it;
+    std::rotate(it, second, second + 1);
+    ++it;
+  }
+}
+bool io_service::start_next_attempt(io_channel* ctx, int& error)
+{
+  while (ctx->next_attempt_ < ctx->remote_eps_.size())
+  {
+    auto s = std::make_shared<xxsocket>();
+    int ret = connect_attempt(ctx, s, ctx->remote_eps_[ctx->next_attempt_++]);
     if (ret == 0)
     {
-      // tcp connect directly, for udp do not need to connect.
-      if (yasio__testbits(ctx->properties_, YCM_TCP))
-        ret = xxsocket::connect(ctx->socket_->native_handle(), ep);
-      // join the multicast group for udp
-      if (yasio__testbits(ctx->properties_, YCPF_MCAST))
-        ctx->join_multicast_group();
+      handle_attempt_succeed(ctx, std::move(s));
+      return true;
     }
-
-    if (ret < 0)
-    { // setup non-blocking connect
-      int error = xxsocket::get_last_errno();
-      if (error != EINPROGRESS && error != EWOULDBLOCK)
-        this->handle_connect_failed(ctx, error);
-      else
+    if (ret == EINPROGRESS)
+    {
+      ctx->racing_sockets_.push_back(std::move(s));
+      if (ctx->next_attempt_ < ctx->remote_eps_.size())
       {
-        ctx->set_last_errno(EINPROGRESS);
-        io_watcher_.mod_event(ctx->socket_->native_handle(), socket_event::readwrite, 0);
-        ctx->timer_.expires_from_now(std::chrono::microseconds(options_.connect_timeout_));
-        ctx->timer_.async_wait_once([ctx](io_service& thiz) {
-          if (ctx->state_ != io_base::state::OPENED)
-            thiz.handle_connect_failed(ctx, ETIMEDOUT);
+        ctx->attempt_timer_.expires_from_now(std::chrono::microseconds(options_.connect_attempt_delay_));
+        ctx->attempt_timer_.async_wait_once([ctx](io_service& thiz) {
+          if (ctx->state_ == io_base::state::CONNECTING)
+            thiz.continue_attempts(ctx, ETIMEDOUT);
         });
       }
+      return true;
     }
-    else if (ret == 0)
-    { // connect server successful immediately.
-      io_watcher_.mod_event(ctx->socket_->native_handle(), socket_event::read, 0);
-      handle_connect_succeed(ctx, ctx->socket_);
-    } // !!!NEVER GO HERE
+    error = ret;
   }
-  else
-    this->handle_connect_failed(ctx, xxsocket::get_last_errno());
+  return false;
 }
+void io_service::continue_attempts(io_channel* ctx, int error)
+{
+  ctx->attempt_timer_.cancel();
+  if (start_next_attempt(ctx, error))
+    return;
+  if (ctx->socket_->is_open() || !ctx->racing_sockets_.empty())
+    return; // wait the attempts in progress
 
-void io_service::do_connect_completion(io_channel* ctx)
+  handle_connect_failed(ctx, error);
+  ctx->timer_.cancel();
+}
+void io_service::handle_attempt_succeed(io_channel* ctx, xxsocket_ptr s)
 {
-  assert(ctx->state_ == io_base::state::CONNECTING);
-  if (ctx->state_ == io_base::state::CONNECTING)
-  {
-    if (io_watcher_.is_ready(ctx->socket_->native_handle(), socket_event::readwrite))
+  if (s != ctx->socket_)
+  { // a racing attempt won
+    ctx->racing_sockets_.erase(std::remove(ctx->racing_sockets_.begin(), ctx->racing_sockets_.end(), s), ctx->racing_sockets_.end());
+    if (ctx->socket_->is_open())
     {
-      int error = -1;
-      if (ctx->socket_->get_optval(SOL_SOCKET, SO_ERROR, error) >= 0 && error == 0)
-      {
-        // The nonblocking tcp handshake complete, remove write event avoid high-CPU occupation
-        io_watcher_.mod_event(ctx->socket_->native_handle(), 0, socket_event::write);
-        handle_connect_succeed(ctx, ctx->socket_);
-      }
-      else
-        handle_connect_failed(ctx, error);
-      ctx->timer_.cancel();
+      io_watcher_.mod_event(ctx->socket_->native_handle(), 0, socket_event::readwrite);
+      ctx->socket_->close();
     }
+    ctx->socket_ = std::move(s);
+  }
+  cancel_attempts(ctx);
+  if (options_.connect_attempt_delay_ > 0)
+    last_connected_af_ = ctx->socket_->peer_endpoint().af();
+
+  // The nonblocking tcp handshake complete, remove write event avoid high-CPU occupation
+  io_watcher_.mod_event(ctx->socket_->native_handle(), 0, socket_event::write);
+  handle_connect_succeed(ctx, ctx->socket_);
+  ctx->timer_.cancel();
+}
+void io_service::cancel_attempts(io_channel* ctx)
+{
+  ctx->attempt_timer_.cancel();
+  for (auto& s : ctx->racing_sockets_)
+  {
+    io_watcher_.mod_event(s->native_handle(), 0, socket_event::readwrite);
+    s->close();
   }
+  ctx->racing_sockets_.clear();
 }
 #if defined(YASIO_SSL_BACKEND)
 yssl_ctx_st* io_service::init_ssl_context(ssl_role role)
@@ -1697,6 +1996,32 @@ transport_handle_t io_service::allocate_transport(io_channel* ctx, xxsocket_ptr&
   transport->set_primitives();
   return transport;
 }
+char* io_service::acquire_buffer(int& size)
+{
+  int index = 0;
+  int bsize = YASIO_INET_BUFFER_SIZE / 16;
+  for (; index < 2 && bsize <= size; ++index)
+    bsize *= 4;
+  size = bsize;
+
+  auto& pool = buffer_pool_[index];
+  if (!pool.empty())
+  {
+    auto buf = pool.back();
+    pool.pop_back();
+    return buf;
+  }
+  return new char[bsize];
+}
+void io_service::release_buffer(char* buf, int size)
+{
+  int index = size == YASIO_INET_BUFFER_SIZE ? 2 : (size == YASIO_INET_BUFFER_SIZE / 4 ? 1 : 0);
+  auto& pool = buffer_pool_[index];
+  if (pool.size() < YASIO_INET_BUFFER_POOL_SIZE)
+    pool.push_back(buf);
+  else
+    delete[] buf;
+}
 void io_service::deallocate_transport(transport_handle_t t)
 {
   if (t->is_valid())
@@ -1828,7 +2153,16 @@ void io_service::remove_timer(highp_timer* timer)
     }
   }
 }
-bool io_service::open_internal(io_channel* ctx)
+void io_service::set_channel_kind(io_channel* ctx, int kind)
+{
+  assert((kind > 0 && kind <= 0xff) && ((kind & (kind - 1)) != 0));
+  yasio__setlobyte(ctx->properties_, kind & 0xff);
+  if (yasio__testbits(kind, YCM_TCP))
+    ctx->socktype_ = SOCK_STREAM;
+  else if (yasio__testbits(kind, YCM_UDP))
+    ctx->socktype_ = SOCK_DGRAM;
+}
+bool io_service::prepare_open(io_channel* ctx)
 {
   if (ctx->state_ == io_base::state::CONNECTING || ctx->state_ == io_base::state::RESOLVING)
   {
@@ -1840,6 +2174,12 @@ bool io_service::open_internal(io_channel* ctx)
   yasio__setbits(ctx->opmask_, YOPM_OPEN);
 
   ++ctx->connect_id_;
+  return true;
+}
+bool io_service::open_internal(io_channel* ctx)
+{
+  if (!prepare_open(ctx))
+    return false;
 
   this->channel_ops_mtx_.lock();
   if (yasio__find(this->channel_ops_, ctx) == this->channel_ops_.end())
@@ -1916,6 +2256,7 @@ highp_time_t io_service::get_timeout(highp_time_t usec)
 bool io_service::cleanup_channel(io_channel* ctx, bool clear_mask)
 {
   ctx->clear_mutable_flags();
+  cancel_attempts(ctx);
   bool bret = cleanup_io(ctx, clear_mask);
 #if defined(YASIO_ENABLE_PASSIVE_EVENT)
   if (bret && yasio__testbits(ctx->properties_, YCM_SERVER))
@@ -1998,6 +2339,12 @@ void io_service::start_query(io_channel* ctx)
   ctx->query_start_time_ = highp_clock();
 #endif
 #if !defined(YASIO_USE_CARES)
+  if (options_.resolv_threads_ > 0)
+  {
+    post_query(ctx->remote_host_, ctx->remote_port_, ctx);
+    return;
+  }
+
   // init async name query thread state
   auto resolving_host                           = ctx->remote_host_;
   auto resolving_port                           = ctx->remote_port_;
@@ -2022,20 +2369,7 @@ void io_service::start_query(io_channel* ctx)
     // otherwise, we can safe to do follow assignments.
     if (life_token.use_count() < 1)
       return;
-    if (error == 0)
-    {
-      ctx->remote_eps_         = std::move(remote_eps);
-      ctx->query_success_time_ = highp_clock();
-#  if defined(YASIO_ENABLE_ARES_PROFILER)
-      YASIO_KLOGD("[index: %d] query %s succeed, cost: %g(ms)", ctx->index_, ctx->remote_host_.c_str(),
-                  (ctx->query_success_time_ - ctx->query_start_time_) / 1000.0);
-#  endif
-    }
-    else
-    {
-      ctx->set_last_errno(yasio::errc::resolve_host_failed);
-      YASIO_KLOGE("[index: %d] query %s failed, ec=%d, detail:%s", ctx->index_, ctx->remote_host_.c_str(), error, xxsocket::gai_strerror(error));
-    }
+    complete_query(ctx, error, remote_eps);
     this->wakeup();
   });
   async_resolv_thread.detach();
@@ -2054,6 +2388,120 @@ void io_service::start_query(io_channel* ctx)
   ::ares_getaddrinfo(this->ares_, ctx->remote_host_.c_str(), service, &hint, io_service::ares_getaddrinfo_cb, ctx);
 #endif
 }
+#if !defined(YASIO_USE_CARES)
+bool io_service::prefetch(const char* hostname, unsigned short port)
+{
+  if (options_.resolv_threads_ <= 0)
+    return false;
+  post_query(hostname, port, nullptr);
+  return true;
+}
+void io_service::post_query(const std::string& host, u_short port, io_channel* ctx)
+{
+  auto& pool = resolv_pool_;
+
+  std::string key = host;
+  key += ':';
+  key += std::to_string(port);
+
+  std::unique_lock<std::mutex> pool_lck(pool->mtx);
+  if (pool->stopped)
+    return;
+  auto& job = pool->jobs[key];
+  if (job)
+  { // the same host:port is already queued or being resolved
+    if (ctx)
+      job->channels.push_back(ctx);
+    return;
+  }
+  job = std::make_shared<resolv_job>();
+  job->key  = std::move(key);
+  job->host = host;
+  job->port = port;
+  if (ctx)
+    job->channels.push_back(ctx);
+  pool->queue.push_back(job);
+
+  if (pool->idle > 0 || pool->threads >= options_.resolv_threads_)
+  {
+    pool->cv.notify_one();
+    return;
+  }
+
+  ++pool->threads;
+  std::weak_ptr<cxx17::shared_mutex> weak_mutex = life_mutex_;
+  std::weak_ptr<life_token> life_token          = life_token_;
+  std::thread resolv_thread([this, pool, life_token, weak_mutex] {
+    yasio::set_thread_name("yasio-resolv");
+    std::unique_lock<std::mutex> pool_lck(pool->mtx);
+    for (;;)
+    {
+      ++pool->idle;
+      pool->cv.wait(pool_lck, [&] { return pool->stopped || !pool->queue.empty(); });
+      --pool->idle;
+      if (pool->stopped)
+        break;
+
+      auto job = std::move(pool->queue.front());
+      pool->queue.pop_front();
+      ++pool->busy; // finalize waits for it, so the service is alive until the resolving is done
+      pool_lck.unlock();
+
+      // preform blocking resolving safe
+      std::vector<ip::endpoint> remote_eps;
+      int error = options_.resolv_(remote_eps, job->host.c_str(), job->port);
+
+      // no more channels can join the job once it leaves the map
+      pool_lck.lock();
+      pool->jobs.erase(job->key);
+      if (--pool->busy == 0 && pool->stopped)
+        pool->drained_cv.notify_all();
+      pool_lck.unlock();
+
+      {
+        auto pmtx = weak_mutex.lock();
+        if (!pmtx)
+          return;
+        cxx17::shared_lock<cxx17::shared_mutex> lck(*pmtx);
+        if (life_token.use_count() < 1)
+          return;
+        for (size_t i = 0; i < job->channels.size(); ++i)
+        {
+          if (i + 1 < job->channels.size())
+          {
+            auto copy_eps = remote_eps;
+            complete_query(job->channels[i], error, copy_eps);
+          }
+          else
+            complete_query(job->channels[i], error, remote_eps);
+        }
+        if (!job->channels.empty())
+          this->wakeup();
+      }
+
+      pool_lck.lock();
+    }
+  });
+  resolv_thread.detach();
+}
+void io_service::complete_query(io_channel* ctx, int error, std::vector<ip::endpoint>& remote_eps)
+{
+  if (error == 0)
+  {
+    ctx->remote_eps_         = std::move(remote_eps);
+    ctx->query_success_time_ = highp_clock();
+#  if defined(YASIO_ENABLE_ARES_PROFILER)
+    YASIO_KLOGD("[index: %d] query %s succeed, cost: %g(ms)", ctx->index_, ctx->remote_host_.c_str(),
+                (ctx->query_success_time_ - ctx->query_start_time_) / 1000.0);
+#  endif
+  }
+  else
+  {
+    ctx->set_last_errno(yasio::errc::resolve_host_failed);
+    YASIO_KLOGE("[index: %d] query %s failed, ec=%d, detail:%s", ctx->index_, ctx->remote_host_.c_str(), error, xxsocket::gai_strerror(error));
+  }
+}
+#endif
 void io_service::update_dns_status()
 {
   if (this->options_.dns_dirty_)
@@ -2068,6 +2516,8 @@ void io_service::update_dns_status()
 }
 int io_service::resolve(std::vector<ip::endpoint>& endpoints, const char* hostname, unsigned short port)
 {
+  if (yasio__testbits(this->ipsv_, ip::ipsv_dual_stack) == ip::ipsv_dual_stack && options_.connect_attempt_delay_ > 0)
+    return xxsocket::resolve(endpoints, hostname, port); // both families, raced by do_connect
   if (yasio__testbits(this->ipsv_, ip::ipsv_ipv4))
     return xxsocket::resolve_v4(endpoints, hostname, port);
   else if (yasio__testbits(this->ipsv_, ip::ipsv_ipv6)) // localhost is IPv6_only network
@@ -2186,11 +2636,24 @@ void io_service::set_option_internal(int opt, va_list ap) // lgtm [cpp/poorly-do
     case YOPT_S_FORWARD_PACKET:
       options_.forward_packet_ = !!va_arg(ap, int);
       break;
+    case YOPT_S_DNS_RESOLV_THREADS:
+      options_.resolv_threads_ = va_arg(ap, int);
+      break;
+    case YOPT_S_CONNECT_ATTEMPT_DELAYMS:
+      options_.connect_attempt_delay_ = static_cast<highp_time_t>(va_arg(ap, int)) * std::milli::den;
+      break;
+    case YOPT_S_CONNECTED_AF:
+      last_connected_af_ = va_arg(ap, int);
+      break;
 #if defined(YASIO_SSL_BACKEND)
     case YOPT_S_SSL_CERT:
       options_.crtfile_ = va_arg(ap, const char*);
       options_.keyfile_ = va_arg(ap, const char*);
       break;
+    case YOPT_S_SSL_SESSION_FN:
+      options_.ssl_session_load_ = *va_arg(ap, ssl_session_load_fn_t*);
+      options_.ssl_session_save_ = *va_arg(ap, ssl_session_save_fn_t*);
+      break;
 #endif
     case YOPT_C_UNPACK_PARAMS: {
       auto channel = channel_at(static_cast<size_t>(va_arg(ap, int)));
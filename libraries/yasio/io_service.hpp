@@ -34,6 +34,8 @@ SOFTWARE.
 #include <mutex>
 #include <thread>
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include <chrono>
 #include <functional>
 #include "sz.hpp"
@@ -179,12 +181,43 @@ enum
   //   keyfile: const char*
   YOPT_S_SSL_CERT,
 
+  // Set the session store of ssl clients for session resumption, native C++ ONLY
+  // params:
+  //   load: ssl_session_load_fn_t*, returns the session saved for the host, empty if none
+  //   save: ssl_session_save_fn_t*, saves the resumable session of an established connection
+  // remarks: both are called on the service thread, the session is saved after the handshake
+  //          and again on close, since TLS 1.3 servers issue tickets after the handshake
+  YOPT_S_SSL_SESSION_FN,
+
   // Set whether forward packet without GC alloc
   // params: forward: int(0)
   // reamrks:
   //   when forward packet enabled, the packet will always dispach when recv data from OS kernel immediately
   YOPT_S_FORWARD_PACKET,
 
+  // Set the number of resolver threads, non c-ares build ONLY
+  // params: threads: int(0)
+  // remarks:
+  //   a. 0 (default) spawns a detached thread for every query
+  //   b. otherwise, queries are queued to at most 'threads' long-lived threads,
+  //      and identical host:port queries waiting or in flight are merged into one
+  YOPT_S_DNS_RESOLV_THREADS,
+
+  // Set the delay between racing connection attempts of a tcp client to its resolved addresses
+  // in milliseconds (RFC 8305 Happy Eyeballs)
+  // params: delay: int(0)
+  // remarks:
+  //   a. 0 (default) connects to the first resolved address only
+  //   b. otherwise, addresses of both families are resolved on dual stack hosts and interleaved
+  //      starting with the family connected last, the next attempt starts when the delay elapsed
+  //      or the previous attempt failed, the first established connection wins
+  YOPT_S_CONNECT_ATTEMPT_DELAYMS,
+
+  // Set the address family attempted first by the next tcp client connection, such as the
+  // connected_af() saved by the last launch
+  // params: af: int(0)
+  YOPT_S_CONNECTED_AF,
+
   // Sets channel length field based frame decode function, native C++ ONLY
   // params: index:int, func:decode_len_fn_t*
   YOPT_C_UNPACK_FN = 101,
@@ -385,6 +418,8 @@ typedef std::function<int(void* d, int n)> decode_len_fn_t;
 typedef std::function<int(std::vector<ip::endpoint>&, const char*, unsigned short)> resolv_fn_t;
 typedef std::function<void(const char*)> print_fn_t;
 typedef std::function<void(int level, const char*)> print_fn2_t;
+typedef std::function<std::string(const char* host)> ssl_session_load_fn_t;
+typedef std::function<void(const char* host, std::string session)> ssl_session_save_fn_t;
 
 typedef std::pair<highp_timer*, timer_cb_t> timer_impl_t;
 
@@ -516,6 +551,7 @@ public:
 
 class YASIO_API io_channel : public io_base {
   friend class io_service;
+  friend class io_send_gather_op;
   friend class io_transport;
   friend class io_transport_tcp;
   friend class io_transport_ssl;
@@ -601,6 +637,9 @@ private:
   // The timer for check resolve & connect timeout
   highp_timer timer_;
 
+  // The timer for starting the next connection attempt, see YOPT_S_CONNECT_ATTEMPT_DELAYMS
+  highp_timer attempt_timer_;
+
 #if !defined(YASIO_NO_USER_TIMER)
   // The timer for user
   highp_timer user_timer_;
@@ -630,6 +669,10 @@ private:
   std::string remote_host_;
   std::vector<ip::endpoint> remote_eps_;
 
+  // The sockets racing socket_ to the other remote_eps_, and the index of the next one to attempt
+  std::vector<xxsocket_ptr> racing_sockets_;
+  size_t next_attempt_ = 0;
+
   ip::endpoint multiaddr_, multiif_;
 
   // Current it's only for UDP
@@ -689,11 +732,29 @@ public:
 
   YASIO__DECL virtual int perform(transport_handle_t transport, const void* buf, int n, int& error);
 
+  // Sends the remain data from offset_
+  virtual int perform_remain(transport_handle_t transport, int& error)
+  {
+    return perform(transport, buffer_.data() + offset_, static_cast<int>(buffer_.size() - offset_), error);
+  }
+
 #if !defined(YASIO_DISABLE_OBJECT_POOL)
   DEFINE_CONCURRENT_OBJECT_POOL_ALLOCATION(io_send_op, 128)
 #endif
 };
 
+// for tcp transport only, sends several buffers in order with one gather write
+class YASIO_API io_send_gather_op : public io_send_op {
+public:
+  YASIO__DECL io_send_gather_op(std::vector<io_send_buffer>&& buffers, completion_cb_t&& handler);
+
+  YASIO__DECL int perform_remain(transport_handle_t transport, int& error) override;
+#if !defined(YASIO_DISABLE_OBJECT_POOL)
+  DEFINE_CONCURRENT_OBJECT_POOL_ALLOCATION(io_send_gather_op, 32)
+#endif
+  std::vector<io_send_buffer> buffers_;
+};
+
 // for udp transport only
 class YASIO_API io_sendto_op : public io_send_op {
 public:
@@ -712,6 +773,7 @@ class io_transport : public io_base {
   friend class io_service;
   friend class io_send_op;
   friend class io_sendto_op;
+  friend class io_send_gather_op;
   friend class io_event;
 
   io_transport(const io_transport&) = delete;
@@ -726,6 +788,7 @@ public:
 
   virtual ~io_transport()
   {
+    release_buffer();
     ctx_ = nullptr;
     send_queue_.clear();
   }
@@ -745,6 +808,9 @@ protected:
   // Call at user thread
   YASIO__DECL virtual int write(io_send_buffer&&, completion_cb_t&&);
 
+  // Call at user thread, tcp only
+  YASIO__DECL int writev(std::vector<io_send_buffer>&&, completion_cb_t&&);
+
   // Call at user thread
   virtual int write_to(io_send_buffer&&, const ip::endpoint&, completion_cb_t&&)
   {
@@ -769,8 +835,14 @@ protected:
 
   bool is_valid() const { return ctx_ != nullptr; }
 
-  char buffer_[YASIO_INET_BUFFER_SIZE]; // recv buffer, 64K
-  int offset_ = 0;                      // recv buffer offset
+  // Grow the recv buffer to the next size class which is larger than min_size, keeps the data
+  YASIO__DECL void grow_buffer(int min_size);
+  YASIO__DECL void release_buffer();
+
+  char* buffer_    = nullptr; // recv buffer, pooled by io_service, acquired on the first read
+  int buffer_size_ = 0;       // recv buffer capacity, up to YASIO_INET_BUFFER_SIZE
+  int offset_      = 0;       // recv buffer offset
+  bool buffer_full_ = false;  // the last read filled the recv buffer
 
   int expected_size_ = -1;
   sbyte_buffer expected_packet_;
@@ -797,8 +869,12 @@ public:
 
   YASIO__DECL void do_ssl_shutdown();
 
+  bool session_reused() const { return session_reused_; }
+
 protected:
   YASIO__DECL int do_ssl_handshake(int& error); // always invoke at do_read
+  YASIO__DECL void save_ssl_session();
+  bool session_reused_ = false;
   yssl_st* ssl_ = nullptr;
 };
 #else
@@ -1025,6 +1101,9 @@ public:
   // the additional API to get rtt of tcp transport
   YASIO__DECL static unsigned int tcp_rtt(transport_handle_t);
 
+  // the additional API to check whether the ssl transport resumed a session, see YOPT_S_SSL_SESSION_FN
+  YASIO__DECL static bool ssl_session_reused(transport_handle_t);
+
 public:
   YASIO__DECL io_service();
   YASIO__DECL io_service(int channel_count);
@@ -1047,6 +1126,9 @@ public:
   bool is_running() const { return this->state_ == io_service::state::RUNNING; }
   bool is_stopping() const { return !!this->stop_flag_; }
 
+  // the address family of the last established tcp client connection, see YOPT_S_CONNECT_ATTEMPT_DELAYMS
+  int connected_af() const { return this->last_connected_af_; }
+
   // should call at the thread who care about async io
   // events(CONNECT_RESPONSE,CONNECTION_LOST,PACKET), such cocos2d-x opengl or
   // any other game engines' render thread.
@@ -1060,6 +1142,10 @@ public:
   // open a channel, default: YCK_TCP_CLIENT
   YASIO__DECL bool open(size_t index, int kind = YCK_TCP_CLIENT);
 
+  // open many channels with a single wakeup of the service thread, each item is {index, kind}
+  // @retval the count of channels opened
+  YASIO__DECL int open(const std::pair<int, int>* channels, size_t count);
+
   // check whether the channel is open
   YASIO__DECL bool is_open(int index) const;
   // check whether the transport is open
@@ -1089,6 +1175,16 @@ public:
   YASIO__DECL int write(transport_handle_t thandle, sbyte_buffer buffer, completion_cb_t completion_handler = nullptr);
   YASIO__DECL int forward(transport_handle_t thandle, const void* buf, size_t len, completion_cb_t completion_handler);
 
+  /*
+  ** summary: Write several buffers to a TCP transport in order with one gather write, the buffers
+  **          are not merged, the const buffers must stay valid until the completion handler called.
+  ** retval: < 0: failed, otherwise the total bytes queued
+  ** remark:
+  **        + TCP: gather write with writev/WSASend
+  **        + SSL: the buffers are passed to SSL_write one by one
+  */
+  YASIO__DECL int writev(transport_handle_t thandle, std::vector<io_send_buffer> buffers, completion_cb_t completion_handler = nullptr);
+
   /*
    ** Summary: Write data to unconnected UDP transport with specified address.
    ** retval: < 0: failed
@@ -1108,6 +1204,13 @@ public:
 
   YASIO__DECL int resolve(std::vector<ip::endpoint>& endpoints, const char* hostname, unsigned short port = 0);
 
+#if !defined(YASIO_USE_CARES)
+  // Queue a lookup to the resolver threads without a channel, the result is dropped, it's useful to warm
+  // the cache of a custom resolver up, never blocks, non c-ares build ONLY
+  // @retval false if YOPT_S_DNS_RESOLV_THREADS isn't set
+  YASIO__DECL bool prefetch(const char* hostname, unsigned short port = 0);
+#endif
+
   // Gets channel by index
   YASIO__DECL io_channel* channel_at(size_t index) const;
 
@@ -1131,6 +1234,14 @@ private:
   // Start a async domain name query
   YASIO__DECL void start_query(io_channel*);
 
+#if !defined(YASIO_USE_CARES)
+  // Queue a domain name query to the resolver threads, the channel could be nullptr
+  YASIO__DECL void post_query(const std::string& host, u_short port, io_channel*);
+
+  // Apply the query result to the channel, the life_mutex_ must be held
+  YASIO__DECL void complete_query(io_channel*, int error, std::vector<ip::endpoint>& remote_eps);
+#endif
+
   YASIO__DECL void initialize(const io_hostent* channel_eps /* could be nullptr */, int channel_count);
   YASIO__DECL void finalize();
 
@@ -1138,6 +1249,8 @@ private:
   YASIO__DECL void handle_stop();
 
   YASIO__DECL bool open_internal(io_channel*);
+  YASIO__DECL void set_channel_kind(io_channel*, int kind);
+  YASIO__DECL bool prepare_open(io_channel*);
 
   YASIO__DECL void process_transports();
   YASIO__DECL void process_channels();
@@ -1152,6 +1265,15 @@ private:
   YASIO__DECL void do_connect(io_channel*);
   YASIO__DECL void do_connect_completion(io_channel*);
 
+  // Open the socket and start a non-blocking connect, returns 0, EINPROGRESS or the error
+  YASIO__DECL int connect_attempt(io_channel*, xxsocket_ptr& s, const ip::endpoint& ep);
+  YASIO__DECL void interleave_remote_eps(io_channel*);
+  // Start attempts to the remaining addresses until one is in progress, returns false if none left
+  YASIO__DECL bool start_next_attempt(io_channel*, int& error);
+  YASIO__DECL void continue_attempts(io_channel*, int error);
+  YASIO__DECL void handle_attempt_succeed(io_channel*, xxsocket_ptr s);
+  YASIO__DECL void cancel_attempts(io_channel*);
+
 #if defined(YASIO_SSL_BACKEND)
   YASIO__DECL yssl_ctx_st* init_ssl_context(ssl_role role);
   YASIO__DECL void cleanup_ssl_context(ssl_role role);
@@ -1177,6 +1299,10 @@ private:
   YASIO__DECL transport_handle_t allocate_transport(io_channel*, xxsocket_ptr&&);
   YASIO__DECL void deallocate_transport(transport_handle_t);
 
+  // The pooled transport recv buffers, see io_transport::grow_buffer
+  YASIO__DECL char* acquire_buffer(int& size);
+  YASIO__DECL void release_buffer(char* buf, int size);
+
   // The major non-blocking event-loop
   YASIO__DECL void run(void);
 
@@ -1260,10 +1386,11 @@ private:
 
   // options
   struct __unnamed_options {
-    highp_time_t connect_timeout_     = 10LL * std::micro::den;
-    highp_time_t dns_cache_timeout_   = 600LL * std::micro::den;
-    highp_time_t dns_queries_timeout_ = 5LL * std::micro::den;
-    int dns_queries_tries_            = 5;
+    highp_time_t connect_timeout_       = 10LL * std::micro::den;
+    highp_time_t connect_attempt_delay_ = 0;
+    highp_time_t dns_cache_timeout_     = 600LL * std::micro::den;
+    highp_time_t dns_queries_timeout_   = 5LL * std::micro::den;
+    int dns_queries_tries_              = 5;
 
     bool dns_dirty_ = false;
 
@@ -1283,6 +1410,8 @@ private:
 
     bool no_new_thread_ = false;
 
+    int resolv_threads_ = 0;
+
     // The resolve function
     resolv_fn_t resolv_;
     // the event callback
@@ -1297,6 +1426,10 @@ private:
     // SSL server
     std::string crtfile_;
     std::string keyfile_;
+
+    // SSL client session store
+    ssl_session_load_fn_t ssl_session_load_;
+    ssl_session_save_fn_t ssl_session_save_;
 #endif
 
 #if defined(YASIO_USE_CARES)
@@ -1304,8 +1437,13 @@ private:
 #endif
   } options_;
 
+  // The free recv buffers of each size class: YASIO_INET_BUFFER_SIZE/16, /4 and YASIO_INET_BUFFER_SIZE
+  std::vector<char*> buffer_pool_[3];
+
   // The ip stack version supported by localhost
   u_short ipsv_ = 0;
+  // The address family of the last established tcp client connection, attempted first
+  std::atomic<int> last_connected_af_{0};
   // The stop flag to notify all transports needs close
   uint8_t stop_flag_ = 0;
 #if defined(YASIO_SSL_BACKEND)
@@ -1319,6 +1457,26 @@ private:
   struct life_token {};
   std::shared_ptr<life_token> life_token_;
   std::shared_ptr<cxx17::shared_mutex> life_mutex_;
+
+  // the resolver threads, shared with them so that they can outlive the service
+  struct resolv_job {
+    std::string key; // host:port
+    std::string host;
+    u_short port;
+    std::vector<io_channel*> channels;
+  };
+  struct resolv_pool {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<resolv_job>> queue;
+    std::unordered_map<std::string, std::shared_ptr<resolv_job>> jobs; // queued or in flight
+    std::condition_variable drained_cv;
+    int threads  = 0;
+    int idle     = 0;
+    int busy     = 0; // in the resolver function, which may reach the service and its user
+    bool stopped = false;
+  };
+  std::shared_ptr<resolv_pool> resolv_pool_; // created by initialize, only stopped by finalize
 #endif
 }; // io_service
 
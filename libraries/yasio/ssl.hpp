@@ -29,6 +29,7 @@ SOFTWARE.
 #ifndef YASIO__SSL_HPP
 #define YASIO__SSL_HPP
 
+#include <string>
 #include "config.hpp"
 
 #if YASIO_SSL_BACKEND == 1 // OpenSSL
@@ -90,6 +91,16 @@ YASIO__DECL const char* yssl_strerror(yssl_st* ssl, int sslerr, char* buf, size_
 
 YASIO__DECL int yssl_write(yssl_st* ssl, const void* data, size_t len, int& err);
 YASIO__DECL int yssl_read(yssl_st* ssl, void* data, size_t len, int& err);
+
+/**
+* Client session resumption, the session is serialized so that it can be cached by host or persisted
+*   yssl_get_session: returns the resumable session of the connection, empty if none
+*   yssl_set_session: offers the session saved before, call before the handshake
+*   yssl_session_reused: whether the handshake resumed the offered session
+*/
+YASIO__DECL std::string yssl_get_session(yssl_st* ssl);
+YASIO__DECL bool yssl_set_session(yssl_st* ssl, const void* data, size_t len);
+YASIO__DECL bool yssl_session_reused(yssl_st* ssl);
 #endif
 
 ///////////////////////////////////////////////////////////////////
@@ -383,7 +383,7 @@ void xxsocket::traverse_local_address(std::function<bool(const ip::endpoint&)> h
     return;
   }
 
-  endpoint ep;
+  ip::endpoint ep;
   /* Walk through linked list*/
   for (ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next)
   {
@@ -765,6 +765,23 @@ int xxsocket::recv_n(socket_native_type s, void* buf, int len, std::chrono::micr
 int xxsocket::send(const void* buf, int len, int flags) const { return static_cast<int>(::send(this->fd, (const char*)buf, len, flags)); }
 int xxsocket::send(socket_native_type s, const void* buf, int len, int flags) { return static_cast<int>(::send(s, (const char*)buf, len, flags)); }
 
+int xxsocket::sendv(const iovec_t* bufs, int count, int flags) const { return xxsocket::sendv(this->fd, bufs, count, flags); }
+int xxsocket::sendv(socket_native_type s, const iovec_t* bufs, int count, int flags)
+{
+#if defined(_WIN32)
+  DWORD bytes_sent = 0;
+  if (::WSASend(s, const_cast<iovec_t*>(bufs), static_cast<DWORD>(count), &bytes_sent, static_cast<DWORD>(flags), nullptr, nullptr) == 0)
+    return static_cast<int>(bytes_sent);
+  return -1;
+#else
+  msghdr msg;
+  ::memset(&msg, 0x0, sizeof(msg));
+  msg.msg_iov    = const_cast<iovec_t*>(bufs);
+  msg.msg_iovlen = count;
+  return static_cast<int>(::sendmsg(s, &msg, flags));
+#endif
+}
+
 int xxsocket::recv(void* buf, int len, int flags) const { return static_cast<int>(this->recv(this->fd, buf, len, flags)); }
 int xxsocket::recv(socket_native_type s, void* buf, int len, int flags) { return static_cast<int>(::recv(s, (char*)buf, len, flags)); }
 
@@ -604,6 +604,25 @@ enum : u_short
 using namespace yasio::inet::ip;
 #endif
 
+/*
+** The native buffer of gather write: WSABUF on win32, iovec on posix
+*/
+#if defined(_WIN32)
+typedef WSABUF iovec_t;
+inline void iovec_set(iovec_t& v, const void* d, size_t n)
+{
+  v.buf = (CHAR*)d;
+  v.len = static_cast<ULONG>(n);
+}
+#else
+typedef struct iovec iovec_t;
+inline void iovec_set(iovec_t& v, const void* d, size_t n)
+{
+  v.iov_base = (void*)d;
+  v.iov_len  = n;
+}
+#endif
+
 /*
 ** CLASS xxsocket: a posix socket wrapper
 */
@@ -818,6 +837,15 @@ public:
   YASIO__DECL int send(const void* buf, int len, int flags = 0) const;
   YASIO__DECL static int send(socket_native_type fd, const void* buf, int len, int flags = 0);
 
+  /* @brief: Sends several buffers in order on this connected socket with one gather write
+  ** @params: omit
+  **
+  ** @returns:
+  **         Same as send, the total number of bytes sent of all buffers.
+  */
+  YASIO__DECL int sendv(const iovec_t* bufs, int count, int flags = 0) const;
+  YASIO__DECL static int sendv(socket_native_type fd, const iovec_t* bufs, int count, int flags = 0);
+
   /* @brief: Receives data from this connected socket or a bound connectionless socket.
   ** @params: omit
   **
@@ -1,5 +1,14 @@
 #include "includes.h"
+#include <atomic>
+#include "base/Director.h"
 #include "network/HttpClient.h"
+#include "yasio.hpp"
+
+// Both drop back to 0 once every bridged request got its response, anything else is a leak
+struct CCHttpBridgeCounters {
+    static inline std::atomic<int> requestsAlive{0};       // CCHttpRequestBridge objects
+    static inline std::atomic<int> legacyRequestsHeld{0};  // retains of CCHttpRequest not released yet
+};
 
 
 static extension::CCHttpClient* (__thiscall* CCHttpClient_c)(extension::CCHttpClient* self);
@@ -8,6 +17,11 @@ static extension::CCHttpClient* __fastcall CCHttpClient_c_H(extension::CCHttpCli
 
     auto ret = CCHttpClient_c(self);
 
+    // GD gets the client before its first request, resolve the hosts used last launch meanwhile
+    // and connect to the two most used
+    auto snapshotFile = CCFileUtils::sharedFileUtils()->getWritablePath() + "ConcurrentHTTP.snapshot";
+    network::HttpClient::getInstance()->enableWarmupSnapshot(snapshotFile, 4, 2);
+
     return ret;
 }
 
@@ -17,6 +31,10 @@ static void __fastcall CCHttpClient_destroyInstance_H(extension::CCHttpClient* s
 
     network::HttpClient::destroyInstance();
 
+    if (CCHttpBridgeCounters::requestsAlive > 0 || CCHttpBridgeCounters::legacyRequestsHeld > 0)
+        AXLOG("HttpClient: bridge leaked %d requests, %d CCHttpRequest retains", CCHttpBridgeCounters::requestsAlive.load(),
+              CCHttpBridgeCounters::legacyRequestsHeld.load());
+
     CCHttpClient_destroyInstance(self);
 }
 
@@ -36,64 +54,179 @@ static bool __fastcall CCHttpClient_lazyInitThreadSemphore_H(extension::CCHttpCl
     return true;
 }
 
-static void(__thiscall* CCHttpClient_send)(extension::CCHttpClient* self, extension::CCHttpRequest*);
+// serialize the parsed headers back into the raw block libcurl used to hand out, sized up front so it's one write
+static void copyResponseHeaders(network::HttpResponse* response, std::vector<char>& rawHeader) {
+
+    auto& headers = response->getResponseHeaders();
+    if (headers.empty())
+        return;
+
+    char statusLine[32];
+    int statusLength = snprintf(statusLine, sizeof(statusLine), "HTTP/1.1 %d\r\n", (int)response->getResponseCode());
+
+    size_t size = statusLength + 2;
+    for (auto&& header : headers)
+        size += header.first.size() + header.second.size() + 4;
+
+    rawHeader.clear();
+    rawHeader.reserve(size);
+    rawHeader.insert(rawHeader.end(), statusLine, statusLine + statusLength);
+    for (auto&& header : headers) {
+        rawHeader.insert(rawHeader.end(), header.first.begin(), header.first.end());
+        rawHeader.push_back(':');
+        rawHeader.push_back(' ');
+        rawHeader.insert(rawHeader.end(), header.second.begin(), header.second.end());
+        rawHeader.push_back('\r');
+        rawHeader.push_back('\n');
+    }
+    rawHeader.push_back('\r');
+    rawHeader.push_back('\n');
+}
 
-static void __fastcall CCHttpClient_send_H(extension::CCHttpClient* self, void*, extension::CCHttpRequest* request) {
-    
-    network::HttpRequest* newRequest = new network::HttpRequest();
-
-    request->retain();
-
-    network::HttpRequest::Type type;
-
-    switch (request->getRequestType())
-    {
-    case extension::CCHttpRequest::kHttpGet:
-        type = network::HttpRequest::Type::GET;
-        break;
-    case extension::CCHttpRequest::kHttpPost:
-        type = network::HttpRequest::Type::POST;
-        break;
-    case extension::CCHttpRequest::kHttpPut:
-        type = network::HttpRequest::Type::PUT;
-        break;
-    case extension::CCHttpRequest::kHttpDelete:
-        type = network::HttpRequest::Type::DELETE;
-        break;
-    case extension::CCHttpRequest::kHttpUnkown:
-        type = network::HttpRequest::Type::UNKNOWN;
-        break;
+// libcurl filled the error buffer for transport failures only, keep that and describe the yasio error
+static void copyErrorBuffer(network::HttpResponse* response, std::string& errorBuffer) {
+
+    int internalCode = response->getInternalCode();
+    if (internalCode != 0) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "%s (yasio error %d)", yasio::io_service::strerror(internalCode), internalCode);
+        errorBuffer = buffer;
+    }
+    else if (!response->isSucceed() && response->getResponseCode() == -1)
+        errorBuffer = "Invalid url or request aborted";
+}
+
+// reads the protected fields of the legacy request in place, its getters return them by value
+struct CCHttpRequestFields : extension::CCHttpRequest {
+    static const std::vector<std::string>& headers(extension::CCHttpRequest* request) {
+        return request->*(&CCHttpRequestFields::_headers);
+    }
+};
+
+// A request which borrows the url, body and user data of the legacy request instead of copying them,
+// and hands the response back through a fixed trampoline rather than a std::function.
+// The legacy request is retained until the response is dispatched, CCObject refcounts aren't atomic,
+// so it's released on the game thread only.
+class CCHttpRequestBridge : public network::HttpRequest {
+public:
+    explicit CCHttpRequestBridge(extension::CCHttpRequest* request) : _legacyRequest(request) {
+
+        request->retain();
+        ++CCHttpBridgeCounters::legacyRequestsHeld;
+        ++CCHttpBridgeCounters::requestsAlive;
+
+        setRequestType(convertRequestType(request->getRequestType()));
+        setUrl(request->getUrl());
+        if (request->getRequestDataSize() > 0)
+            setRequestDataView(request->getRequestData(), request->getRequestDataSize());
+        setUserData(request->getUserData());
+        setResponseHandler(&CCHttpRequestBridge::dispatchResponse);
+    }
+
+    ~CCHttpRequestBridge() {
+
+        --CCHttpBridgeCounters::requestsAlive;
+
+        // never dispatched, e.g. the client was destroyed first, the last reference may go on any thread
+        if (auto request = _legacyRequest) {
+            Director::getInstance()->getScheduler()->runOnAxmolThread([request] {
+                releaseLegacyRequest(request);
+            });
+        }
+    }
+
+    extension::CCHttpRequest* getLegacyRequest() const { return _legacyRequest; }
+
+private:
+    static void releaseLegacyRequest(extension::CCHttpRequest* request) {
+        request->release();
+        --CCHttpBridgeCounters::legacyRequestsHeld;
     }
 
-    newRequest->setRequestType(type);
-    newRequest->setUrl(request->getUrl());
-    newRequest->setRequestData(request->getRequestData(), request->getRequestDataSize());
-    newRequest->setTag(request->getTag());
-    newRequest->setUserData(request->getUserData());
-    newRequest->setHeaders(request->getHeaders());
+    static network::HttpRequest::Type convertRequestType(extension::CCHttpRequest::HttpRequestType type) {
+        switch (type)
+        {
+        case extension::CCHttpRequest::kHttpGet:
+            return network::HttpRequest::Type::GET;
+        case extension::CCHttpRequest::kHttpPost:
+            return network::HttpRequest::Type::POST;
+        case extension::CCHttpRequest::kHttpPut:
+            return network::HttpRequest::Type::PUT;
+        case extension::CCHttpRequest::kHttpDelete:
+            return network::HttpRequest::Type::DELETE;
+        default:
+            return network::HttpRequest::Type::UNKNOWN;
+        }
+    }
 
-    newRequest->setResponseCallback([=](network::HttpClient* client, network::HttpResponse* response){
+    // what the legacy response is built from, taken out of the HttpResponse on the thread it's dispatched on
+    struct LegacyResult {
+        extension::CCHttpRequest* request;
+        bool succeed;
+        int responseCode;
+        yasio::sbyte_buffer data;
+        std::vector<char> header;
+        std::string errorBuffer;
+    };
+
+    static void dispatchResponse(network::HttpClient* client, network::HttpResponse* response) {
+
+        // HttpClient may dispatch on a worker pool or the network thread, and releases the response afterwards,
+        // so the result is moved out here and the CCObjects are only touched on the game thread
+        auto bridge = static_cast<CCHttpRequestBridge*>(response->getHttpRequest());
+        auto result = new LegacyResult();
+        result->request = bridge->_legacyRequest;
+        bridge->_legacyRequest = nullptr;
+        result->succeed = response->isSucceed();
+        result->responseCode = (int)response->getResponseCode();
+        result->data = std::move(*response->getResponseData());
+        copyResponseHeaders(response, result->header);
+        copyErrorBuffer(response, result->errorBuffer);
+
+        auto director = Director::getInstance();
+        if (std::this_thread::get_id() == director->getAxmolThreadId())
+            dispatchLegacyResult(result);
+        else
+            director->getScheduler()->runOnAxmolThread([result] { dispatchLegacyResult(result); });
+    }
+
+    static void dispatchLegacyResult(LegacyResult* result) {
+
+        auto request = result->request;
         extension::SEL_HttpResponse pSelector = request->getSelector();
         CCObject* pTarget = request->getTarget();
-        
+
         extension::CCHttpClient* oldClient = extension::CCHttpClient::getInstance();
         extension::CCHttpResponse* oldResponse = new extension::CCHttpResponse(request);
-        oldResponse->setSucceed(response->isSucceed());
-        std::vector<char>* charData = new std::vector<char>();
-        for (int i = 0; i < response->getResponseData()->size(); i++) {
-            charData->push_back(response->getResponseData()->at(i));
-        }
-        oldResponse->setResponseData(charData);
-        delete charData;
-        oldResponse->setResponseCode(response->getResponseCode());
+        oldResponse->setSucceed(result->succeed);
+        oldResponse->getResponseData()->assign(result->data.begin(), result->data.end());
+        oldResponse->setResponseCode(result->responseCode);
+        oldResponse->getResponseHeader()->swap(result->header);
+        if (!result->errorBuffer.empty())
+            oldResponse->setErrorBuffer(result->errorBuffer.c_str());
+        delete result;
 
         if (pTarget && pSelector) {
             (pTarget->*pSelector)(oldClient, oldResponse);
         }
-        oldClient->release();
         oldResponse->release();
-    });
-    network::HttpClient::getInstance()->send(newRequest);
+        releaseLegacyRequest(request);
+    }
+
+    extension::CCHttpRequest* _legacyRequest;
+};
+
+static void(__thiscall* CCHttpClient_send)(extension::CCHttpClient* self, extension::CCHttpRequest*);
+
+static void __fastcall CCHttpClient_send_H(extension::CCHttpClient* self, void*, extension::CCHttpRequest* request) {
+
+    CCHttpRequestBridge* newRequest = new CCHttpRequestBridge(request);
+
+    // GD sends a few fixed header sets, each is serialized once and found by its hash
+    auto client = network::HttpClient::getInstance();
+    newRequest->setHeaderTemplate(client->acquireHeaderTemplate(CCHttpRequestFields::headers(request)));
+
+    client->send(newRequest);
 
     newRequest->release();
 
@@ -106,6 +106,7 @@ public:
     const_iterator unsafe_end() const { return this->queue_.end(); }
 
     iterator unsafe_erase(iterator iter) { return this->queue_.erase(iter); }
+    iterator unsafe_insert(iterator iter, const _Ty& value) { return this->queue_.insert(iter, value); }
 
 private:
     std::deque<_Ty> queue_;
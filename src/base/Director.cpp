@@ -67,6 +67,8 @@ Director::Director() {}
 
 bool Director::init()
 {
+    // created by the first getInstance, which the hooks only call on the game thread
+    _axmol_thread_id = std::this_thread::get_id();
 
     _scheduler = new Scheduler();
 
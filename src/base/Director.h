@@ -81,7 +81,7 @@ public:
     bool init();
     
     void setScheduler(Scheduler* scheduler);
-    Scheduler* Director::getScheduler();
+    Scheduler* getScheduler();
     const std::thread::id& getAxmolThreadId() const { return _axmol_thread_id; }
 
 protected:
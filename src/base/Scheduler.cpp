@@ -31,6 +31,8 @@ THE SOFTWARE.
 #include "Director.h"
 #include "CArray.h"
 #include "utlist.h"
+#include <algorithm>
+#include <chrono>
 
 
 // data structures
@@ -78,6 +80,8 @@ Timer::Timer()
     , _delay(0.0f)
     , _interval(0.0f)
     , _aborted(false)
+    , _lastUpdateTime(0)
+    , _heapGeneration(0)
 {}
 
 void Timer::setupTimerWithInterval(float seconds, unsigned int repeat, float delay)
@@ -148,6 +152,14 @@ bool Timer::isExhausted() const
     return !_runForever && _timesExecuted > _repeat;
 }
 
+float Timer::getTimeToNextTrigger() const
+{
+    if (_elapsed == -1)
+        return 0;
+    float threshold = _useDelay ? _delay : _interval;
+    return (std::max)(threshold - _elapsed, 0.0f);
+}
+
 // TimerTargetSelector
 
 TimerTargetSelector::TimerTargetSelector() : _target(nullptr), _selector(nullptr) {}
@@ -230,18 +242,69 @@ Scheduler::Scheduler()
     , _currentTarget(nullptr)
     , _currentTargetSalvaged(false)
     , _updateHashLocked(false)
+    , _timerTime(0)
+    , _updatingTimers(false)
+    , _staleTimers(0)
+    , _actionsToPerform(8 * moodycamel::ConcurrentQueueDefaultTraits::BLOCK_SIZE)
+    , _performTimeBudget(0)
 {
-    // I don't expect to have more than 30 functions to all per frame
-    _actionsToPerform.reserve(30);
 }
 
 Scheduler::~Scheduler()
 {
     unscheduleAll();
+
+    for (auto&& entry : _timerHeap)
+        entry.timer->release();
+    for (auto&& entry : _timersToQueue)
+        entry.timer->release();
+}
+
+void Scheduler::queueTimer(Timer* timer, void* target)
+{
+    // due at once, the first update only starts the timer
+    timer->retain();
+    TimerHeapEntry entry{_timerTime, timer, target, timer->_heapGeneration};
+    if (_updatingTimers)
+        _timersToQueue.emplace_back(entry);
+    else
+    {
+        _timerHeap.emplace_back(entry);
+        std::push_heap(_timerHeap.begin(), _timerHeap.end(), std::greater<TimerHeapEntry>{});
+    }
+}
+
+void Scheduler::dropQueuedTimer(Timer* timer)
+{
+    ++timer->_heapGeneration;
+    ++_staleTimers;
+}
+
+void Scheduler::dropQueuedTimers(ccArrayX* timers)
+{
+    if (timers)
+    {
+        for (int i = 0; i < timers->num; ++i)
+            dropQueuedTimer(static_cast<Timer*>(timers->arr[i]));
+    }
+}
+
+void Scheduler::compactTimerHeap()
+{
+    auto stale = std::remove_if(_timerHeap.begin(), _timerHeap.end(), [](const TimerHeapEntry& entry) {
+        if (entry.generation == entry.timer->_heapGeneration)
+            return false;
+        entry.timer->release();
+        return true;
+    });
+    _timerHeap.erase(stale, _timerHeap.end());
+    std::make_heap(_timerHeap.begin(), _timerHeap.end(), std::greater<TimerHeapEntry>{});
+    _staleTimers = 0;
 }
 
 void Scheduler::removeHashElement(_hashSelectorEntryX* element)
 {
+    dropQueuedTimers(element->timers);
     ccArrayFree(element->timers);
     HASH_DEL(_hashForTimers, element);
     free(element);
@@ -300,6 +363,8 @@ void Scheduler::schedule(const ccSchedulerFunc& callback,
                 AXLOG("CCScheduler#schedule. Reiniting timer with interval %.4f, repeat %u, delay %.4f", interval,
                       repeat, delay);
                 timer->setupTimerWithInterval(interval, repeat, delay);
+                dropQueuedTimer(timer);
+                queueTimer(timer, target);
                 return;
             }
         }
@@ -309,6 +374,7 @@ void Scheduler::schedule(const ccSchedulerFunc& callback,
     TimerTargetCallback* timer = new TimerTargetCallback();
     timer->initWithCallback(this, callback, target, key, interval, repeat, delay);
     ccArrayAppendObject(element->timers, timer);
+    queueTimer(timer, target);
     timer->release();
 }
 
@@ -340,6 +406,7 @@ void Scheduler::unschedule(std::string_view key, void* target)
                     timer->setAborted();
                 }
 
+                dropQueuedTimer(timer);
                 ccArrayRemoveObjectAtIndex(element->timers, i, true);
 
                 // update timerIndex in case we are in tick:, looping over the actions
@@ -612,6 +679,7 @@ void Scheduler::unscheduleAllForTarget(void* target)
             element->currentTimer->retain();
             element->currentTimer->setAborted();
         }
+        dropQueuedTimers(element->timers);
         ccArrayRemoveAllObjects(element->timers);
 
         if (_currentTarget == element)
@@ -755,16 +823,11 @@ void Scheduler::resumeTargets(const std::set<void*>& targetsToResume)
     }
 }
 
-void Scheduler::runOnAxmolThread(std::function<void()> action)
-{
-    std::lock_guard<std::mutex> lock(_performMutex);
-    _actionsToPerform.emplace_back(std::move(action));
-}
-
 void Scheduler::removeAllPendingActions()
 {
-    std::unique_lock<std::mutex> lock(_performMutex);
-    _actionsToPerform.clear();
+    PerformAction actions[PERFORM_BATCH_SIZE];
+    while (_actionsToPerform.try_dequeue_bulk(actions, PERFORM_BATCH_SIZE) > 0)
+        ;
 }
 
 // main loop
@@ -812,44 +875,9 @@ void Scheduler::update(float dt)
         }
     }
 
-    // Iterate over all the custom selectors
-    for (tHashTimerEntryX* elt = _hashForTimers; elt != nullptr;)
-    {
-        _currentTarget         = elt;
-        _currentTargetSalvaged = false;
-
-        if (!_currentTarget->paused)
-        {
-            // The 'timers' array may change while inside this loop
-            for (elt->timerIndex = 0; elt->timerIndex < elt->timers->num; ++(elt->timerIndex))
-            {
-                elt->currentTimer = (Timer*)(elt->timers->arr[elt->timerIndex]);
-                AXASSERT(!elt->currentTimer->isAborted(), "An aborted timer should not be updated");
-
-                elt->currentTimer->update(dt);
-
-                if (elt->currentTimer->isAborted())
-                {
-                    // The currentTimer told the remove itself. To prevent the timer from
-                    // accidentally deallocating itself before finishing its step, we retained
-                    // it. Now that step is done, it's safe to release it.
-                    elt->currentTimer->release();
-                }
-
-                elt->currentTimer = nullptr;
-            }
-        }
-
-        // elt, at this moment, is still valid
-        // so it is safe to ask this here (issue #490)
-        elt = (tHashTimerEntryX*)elt->hh.next;
-
-        // only delete currentTarget if no actions were scheduled during the cycle (issue #481)
-        if (_currentTargetSalvaged && _currentTarget->timers->num == 0)
-        {
-            removeHashElement(_currentTarget);
-        }
-    }
+    // Only the due timers
+    _timerTime += dt;
+    updateTimers();
 
     // delete all updates that are removed in update
     for (auto&& e : _updateDeleteVector)
@@ -864,21 +892,109 @@ void Scheduler::update(float dt)
     // Functions allocated from another thread
     //
 
-    // Testing size is faster than locking / unlocking.
-    // And almost never there will be functions scheduled to be called.
-    if (!_actionsToPerform.empty())
+    // Only the functions queued before now run this frame, so a function queueing another one can't
+    // keep the loop going, the queue blocks are recycled instead of reallocated every frame.
+    size_t pending = _actionsToPerform.size_approx();
+    if (pending != 0)
     {
-        _performMutex.lock();
-        // fixed #4123: Save the callback functions, they must be invoked after '_performMutex.unlock()', otherwise if
-        // new functions are added in callback, it will cause thread deadlock.
-        auto temp = std::move(_actionsToPerform);
-        _performMutex.unlock();
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::microseconds(static_cast<long long>(_performTimeBudget * 1000));
+        PerformAction actions[PERFORM_BATCH_SIZE];
+        while (pending != 0)
+        {
+            size_t n = _actionsToPerform.try_dequeue_bulk(actions, (std::min)(pending, (size_t)PERFORM_BATCH_SIZE));
+            if (n == 0)
+                break;
+            pending -= n;
+            for (size_t i = 0; i < n; ++i)
+            {
+                actions[i]();
+                actions[i].reset();
+            }
+            if (_performTimeBudget > 0 && std::chrono::steady_clock::now() >= deadline)
+                break;
+        }
+    }
+}
+
+void Scheduler::updateTimers()
+{
+    _updatingTimers = true;
+    while (!_timerHeap.empty() && _timerHeap.front().dueTime <= _timerTime + 1e-6)
+    {
+        std::pop_heap(_timerHeap.begin(), _timerHeap.end(), std::greater<TimerHeapEntry>{});
+        auto entry = _timerHeap.back();
+        _timerHeap.pop_back();
+
+        auto timer = entry.timer;
+        tHashTimerEntryX* element = nullptr;
+        if (entry.generation == timer->_heapGeneration)
+            HASH_FIND_PTR(_hashForTimers, &entry.target, element);
+        if (!element)
+        {  // unscheduled or rescheduled meanwhile
+            timer->release();
+            if (_staleTimers > 0)
+                --_staleTimers;
+            continue;
+        }
 
-        for (const auto& function : temp)
+        if (element->paused)
+        {  // the paused time doesn't count, check again next frame
+            timer->_lastUpdateTime = _timerTime;
+            _timersToQueue.emplace_back(entry);
+            continue;
+        }
+
+        _currentTarget         = element;
+        _currentTargetSalvaged = false;
+        element->currentTimer  = timer;
+
+        float elapsed          = static_cast<float>(_timerTime - timer->_lastUpdateTime);
+        timer->_lastUpdateTime = _timerTime;
+        timer->update(elapsed);
+
+        if (timer->isAborted())
+        {
+            // The currentTimer told the remove itself. To prevent the timer from
+            // accidentally deallocating itself before finishing its step, we retained
+            // it. Now that step is done, it's safe to release it.
+            timer->release();
+            timer->release();  // the heap entry
+            if (_staleTimers > 0)
+                --_staleTimers;
+        }
+        else if (entry.generation != timer->_heapGeneration)
+        {  // rescheduled in the callback, queued again already
+            timer->release();
+            if (_staleTimers > 0)
+                --_staleTimers;
+        }
+        else
         {
-            function();
+            entry.dueTime = _timerTime + timer->getTimeToNextTrigger();
+            _timersToQueue.emplace_back(entry);
         }
+
+        element->currentTimer = nullptr;
+
+        // only delete currentTarget if no actions were scheduled during the cycle (issue #481)
+        if (_currentTargetSalvaged && _currentTarget->timers->num == 0)
+            removeHashElement(_currentTarget);
+        _currentTarget = nullptr;
     }
+    _updatingTimers = false;
+
+    // the timers due again this frame wait for the next one
+    for (auto&& entry : _timersToQueue)
+    {
+        _timerHeap.emplace_back(entry);
+        std::push_heap(_timerHeap.begin(), _timerHeap.end(), std::greater<TimerHeapEntry>{});
+    }
+    _timersToQueue.clear();
+
+    // the stale entries due late would otherwise stay retained in the heap until then
+    if (_staleTimers > MAX_STALE_TIMERS || _staleTimers > _timerHeap.size() / 2)
+        compactTimerHeap();
 }
 
 void Scheduler::schedule(SEL_SCHEDULEX selector,
@@ -923,6 +1039,8 @@ void Scheduler::schedule(SEL_SCHEDULEX selector,
                 AXLOG("CCScheduler#schedule. Reiniting timer with interval %.4f, repeat %u, delay %.4f", interval,
                       repeat, delay);
                 timer->setupTimerWithInterval(interval, repeat, delay);
+                dropQueuedTimer(timer);
+                queueTimer(timer, target);
                 return;
             }
         }
@@ -932,6 +1050,7 @@ void Scheduler::schedule(SEL_SCHEDULEX selector,
     TimerTargetSelector* timer = new TimerTargetSelector();
     timer->initWithSelector(this, selector, target, interval, repeat, delay);
     ccArrayAppendObject(element->timers, timer);
+    queueTimer(timer, target);
     timer->release();
 }
 
@@ -996,6 +1115,7 @@ void Scheduler::unschedule(SEL_SCHEDULEX selector, Ref* target)
                     timer->setAborted();
                 }
 
+                dropQueuedTimer(timer);
                 ccArrayRemoveObjectAtIndex(element->timers, i, true);
 
                 // update timerIndex in case we are in tick:, looping over the actions
@@ -32,7 +32,9 @@ THE SOFTWARE.
 #include <functional>
 #include <mutex>
 #include <set>
+#include <type_traits>
 #include <uthash.h>
+#include "concurrentqueue.h"
 #include "Macros.h"
 #include "Ref.h"
 
@@ -40,11 +42,113 @@ THE SOFTWARE.
 typedef std::function<void(float)> ccSchedulerFunc;
 
 class Scheduler;
+
+/**
+ * A move-only void() callable queued by Scheduler::runOnAxmolThread.
+ * Callables up to INLINE_SIZE bytes are stored inline, so the common small lambdas don't allocate
+ * like std::function does.
+ */
+class PerformAction
+{
+public:
+    static constexpr size_t INLINE_SIZE = 48;
+
+    PerformAction() = default;
+
+    template <typename _Fty, typename = std::enable_if_t<!std::is_same<std::decay_t<_Fty>, PerformAction>::value>>
+    PerformAction(_Fty&& func)
+    {
+        typedef std::decay_t<_Fty> F;
+        if constexpr (sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible<F>::value)
+        {
+            new (_storage) F(std::forward<_Fty>(func));
+            _ops = &InlineOps<F>::ops;
+        }
+        else
+        {
+            *reinterpret_cast<F**>(_storage) = new F(std::forward<_Fty>(func));
+            _ops = &HeapOps<F>::ops;
+        }
+    }
+
+    PerformAction(PerformAction&& other) noexcept { moveFrom(other); }
+
+    PerformAction& operator=(PerformAction&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~PerformAction() { reset(); }
+
+    void operator()() { _ops->invoke(_storage); }
+
+    explicit operator bool() const { return _ops != nullptr; }
+
+    void reset()
+    {
+        if (_ops)
+        {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);  // move constructs dst, destroys src
+        void (*destroy)(void* storage);
+    };
+
+    template <typename F>
+    struct InlineOps
+    {
+        static void invoke(void* storage) { (*static_cast<F*>(storage))(); }
+        static void move(void* dst, void* src)
+        {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void destroy(void* storage) { static_cast<F*>(storage)->~F(); }
+        static constexpr Ops ops{invoke, move, destroy};
+    };
+
+    template <typename F>
+    struct HeapOps
+    {
+        static void invoke(void* storage) { (**static_cast<F**>(storage))(); }
+        static void move(void* dst, void* src) { *static_cast<F**>(dst) = *static_cast<F**>(src); }
+        static void destroy(void* storage) { delete *static_cast<F**>(storage); }
+        static constexpr Ops ops{invoke, move, destroy};
+    };
+
+    void moveFrom(PerformAction& other)
+    {
+        if (other._ops)
+        {
+            other._ops->move(_storage, other._storage);
+            _ops       = other._ops;
+            other._ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char _storage[INLINE_SIZE];
+    const Ops* _ops = nullptr;
+};
 /**
  * @cond
  */
 class Timer : public Ref
 {
+    friend class Scheduler;
+
 protected:
     Timer();
 
@@ -60,6 +164,9 @@ public:
     /** triggers the timer */
     void update(float dt);
 
+    /** the seconds until the timer needs an update to trigger, 0 if it needs one every frame */
+    float getTimeToNextTrigger() const;
+
 protected:
     Scheduler* _scheduler;  // weak ref
     float _elapsed;
@@ -70,6 +177,10 @@ protected:
     float _delay;
     float _interval;
     bool _aborted;
+
+    // the due time bookkeeping of Scheduler, see Scheduler::_timerHeap
+    double _lastUpdateTime;
+    unsigned int _heapGeneration;  // bumped to drop the queued heap entries of the timer
 };
 
 class TimerTargetSelector : public Timer
@@ -165,6 +276,15 @@ public:
      */
     static const int PRIORITY_NON_SYSTEM_MIN;
 
+    /** How many functions queued with runOnAxmolThread are taken from the queue at once.
+     */
+    static constexpr int PERFORM_BATCH_SIZE = 16;
+
+    /** How many unscheduled timers may wait in the due time heap before it is rebuilt without them.
+     * The heap is also rebuilt when they are more than half of it.
+     */
+    static constexpr unsigned int MAX_STALE_TIMERS = 64;
+
     /**
      * Constructor
      *
@@ -398,18 +518,34 @@ public:
     void resumeTargets(const std::set<void*>& targetsToResume);
 
     /** Calls a function on the cocos2d thread. Useful when you need to call a cocos2d function from another thread.
-     This function is thread safe.
+     This function is thread safe and lock-free, small callables are queued without allocation.
+     The functions queued by one thread run in order, see setPerformTimeBudget.
      @param function The function to be run in cocos2d thread.
      @since v3.0
      @js NA
      */
-    void runOnAxmolThread(std::function<void()> action);
+    template <typename _Fty>
+    void runOnAxmolThread(_Fty&& action)
+    {
+        _actionsToPerform.enqueue(PerformAction{std::forward<_Fty>(action)});
+    }
 
-    void performFunctionInCocosThread(std::function<void()> action)
+    template <typename _Fty>
+    void performFunctionInCocosThread(_Fty&& action)
     {
-        runOnAxmolThread(std::move(action));
+        runOnAxmolThread(std::forward<_Fty>(action));
     }
 
+    /**
+     * Limit the time spent on the functions queued with Scheduler::runOnAxmolThread per frame,
+     * the rest run on the next frames. It's checked every PERFORM_BATCH_SIZE functions.
+     *
+     * @param milliseconds the budget, 0 (the default) to run all the functions queued before the frame.
+     */
+    void setPerformTimeBudget(float milliseconds) { _performTimeBudget = milliseconds; }
+
+    float getPerformTimeBudget() const { return _performTimeBudget; }
+
     /**
      * Remove all pending functions queued to be performed with Scheduler::runOnAxmolThread
      * Functions unscheduled in this manner will not be executed
@@ -438,6 +574,13 @@ protected:
     void priorityIn(struct _listEntryX** list, const ccSchedulerFunc& callback, void* target, int priority, bool paused);
     void appendIn(struct _listEntryX** list, const ccSchedulerFunc& callback, void* target, bool paused);
 
+    // "selectors with interval" due time stuff
+    void queueTimer(Timer* timer, void* target);
+    void updateTimers();
+    void dropQueuedTimer(Timer* timer);
+    void dropQueuedTimers(struct _ccArray* timers);
+    void compactTimerHeap();
+
     float _timeScale;
 
     //
@@ -456,9 +599,26 @@ protected:
     bool _currentTargetSalvaged;
     // If true unschedule will not remove anything from a hash. Elements will only be marked for deletion.
     bool _updateHashLocked;
+
+    // The timers ordered by due time, so a frame only visits the due timers.
+    // Every entry retains its timer, the entries of an unscheduled timer are dropped lazily when due,
+    // or all at once by compactTimerHeap when too many of them pile up.
+    struct TimerHeapEntry
+    {
+        double dueTime;
+        Timer* timer;
+        void* target;
+        unsigned int generation;
+        bool operator>(const TimerHeapEntry& rhs) const { return dueTime > rhs.dueTime; }
+    };
+    std::vector<TimerHeapEntry> _timerHeap;  // min-heap on dueTime
+    std::vector<TimerHeapEntry> _timersToQueue;  // queued while the heap is being processed
+    double _timerTime;  // the scaled seconds elapsed, the clock of dueTime
+    bool _updatingTimers;
+    unsigned int _staleTimers;  // heap entries dropped since the last compaction, an upper bound
     // Used for "perform action"
-    std::vector<std::function<void()>> _actionsToPerform;
-    std::mutex _performMutex;
+    moodycamel::ConcurrentQueue<PerformAction> _actionsToPerform;
+    float _performTimeBudget;
 };
 
 // end of base group
@@ -0,0 +1,170 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threadCount, int maxQueued)
+    : _maxQueued(static_cast<unsigned int>((std::max)(maxQueued, 1)))
+    , _stopped(false)
+    , _depth(0)
+    , _maxDepth(0)
+    , _nextWorker(0)
+    , _executed(0)
+    , _stolen(0)
+    , _rejected(0)
+{
+    threadCount = (std::max)(threadCount, 1);
+    for (int i = 0; i < threadCount; ++i)
+        _workers.emplace_back(new Worker());
+    for (size_t i = 0; i < _workers.size(); ++i)
+        _workers[i]->thread = std::thread(&WorkerPool::run, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lck(_sleepMutex);
+        _stopped = true;
+    }
+    _sleepCond.notify_all();
+    for (auto&& worker : _workers)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+}
+
+bool WorkerPool::isWorkerThread() const
+{
+    auto id = std::this_thread::get_id();
+    for (auto&& worker : _workers)
+    {
+        if (worker->thread.get_id() == id)
+            return true;
+    }
+    return false;
+}
+
+bool WorkerPool::submitAction(PerformAction&& action)
+{
+    // reserve a slot first, so the bound holds with many producers, under the lock the workers check
+    // before they exit, so a stopped pool can't be left with a task
+    unsigned int depth;
+    {
+        std::lock_guard<std::mutex> lck(_sleepMutex);
+        depth = _stopped ? 0 : ++_depth;
+    }
+    if (depth == 0 || depth > _maxQueued)
+    {
+        if (depth != 0)
+            --_depth;
+        ++_rejected;
+        return false;
+    }
+    auto maxDepth = _maxDepth.load(std::memory_order_relaxed);
+    while (depth > maxDepth && !_maxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+        ;
+
+    auto& worker = *_workers[_nextWorker++ % _workers.size()];
+    {
+        std::lock_guard<std::mutex> lck(worker.mutex);
+        worker.tasks.emplace_back(std::move(action));
+    }
+
+    // the lock pairs with the sleeping check of the workers, so the wakeup can't be lost
+    {
+        std::lock_guard<std::mutex> lck(_sleepMutex);
+    }
+    _sleepCond.notify_one();
+    return true;
+}
+
+bool WorkerPool::takeTask(size_t index, PerformAction& action)
+{
+    // the own queue from the front, first in first out
+    {
+        auto& worker = *_workers[index];
+        std::lock_guard<std::mutex> lck(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            action = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // steal the newest task of another worker, the victim keeps the older ones
+    for (size_t i = 1; i < _workers.size(); ++i)
+    {
+        auto& victim = *_workers[(index + i) % _workers.size()];
+        std::lock_guard<std::mutex> lck(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            action = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            ++_stolen;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::run(size_t index)
+{
+    PerformAction action;
+    for (;;)
+    {
+        if (takeTask(index, action))
+        {
+            --_depth;
+            action();
+            action.reset();
+            ++_executed;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lck(_sleepMutex);
+        if (_depth.load() != 0)
+            continue;  // queued meanwhile, or held by a worker which is about to take it
+        if (_stopped)
+            break;
+        _sleepCond.wait(lck);
+    }
+}
+
+WorkerPool::Stats WorkerPool::getStats() const
+{
+    Stats stats;
+    stats.depth    = _depth.load();
+    stats.maxDepth = _maxDepth.load();
+    stats.executed = _executed.load();
+    stats.stolen   = _stolen.load();
+    stats.rejected = _rejected.load();
+    return stats;
+}
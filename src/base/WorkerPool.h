@@ -0,0 +1,124 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Scheduler.h"  // PerformAction
+
+/**
+ * A small bounded pool of worker threads for work which should block neither the network thread
+ * nor the game thread, such as parsing or decompressing a response.
+ *
+ * Every worker owns a queue, the tasks are spread round-robin and an idle worker steals from the
+ * others, so one slow task doesn't hold back the tasks queued after it.
+ * Use Scheduler::runOnAxmolThread in a task to hop back to the game thread for UI work.
+ */
+class WorkerPool
+{
+public:
+    struct Stats
+    {
+        unsigned int depth    = 0;  /// the tasks queued now
+        unsigned int maxDepth = 0;  /// the max tasks queued at once
+        unsigned long long executed = 0;
+        unsigned long long stolen   = 0;  /// the tasks run by another worker than they were queued to
+        unsigned long long rejected = 0;  /// the tasks refused because the pool was full
+    };
+
+    /**
+     * Start the workers.
+     *
+     * @param threadCount the worker threads.
+     * @param maxQueued the max tasks queued at once, submit fails when it's reached.
+     */
+    WorkerPool(int threadCount, int maxQueued);
+
+    /**
+     * Run the queued tasks and stop the workers.
+     */
+    ~WorkerPool();
+
+    /**
+     * Run the queued tasks and stop the workers, the tasks submitted later are refused.
+     * The destructor does it too, call it to stop a pool which may still be shared.
+     * It must not be called on a worker of the pool.
+     */
+    void stop();
+
+    /**
+     * Whether the calling thread is a worker of the pool, such as to not stop the pool from its own task.
+     */
+    bool isWorkerThread() const;
+
+    /**
+     * Queue a task, it's thread safe.
+     *
+     * @return false if the pool is full, the task is not queued.
+     */
+    template <typename _Fty>
+    bool submit(_Fty&& task)
+    {
+        return submitAction(PerformAction{std::forward<_Fty>(task)});
+    }
+
+    int getThreadCount() const { return static_cast<int>(_workers.size()); }
+
+    Stats getStats() const;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<PerformAction> tasks;
+        std::thread thread;
+    };
+
+    bool submitAction(PerformAction&& action);
+    bool takeTask(size_t index, PerformAction& action);
+    void run(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    const unsigned int _maxQueued;
+
+    std::mutex _sleepMutex;
+    std::condition_variable _sleepCond;
+    bool _stopped;
+
+    std::atomic<unsigned int> _depth;
+    std::atomic<unsigned int> _maxDepth;
+    std::atomic<unsigned int> _nextWorker;
+    std::atomic<unsigned long long> _executed;
+    std::atomic<unsigned long long> _stolen;
+    std::atomic<unsigned long long> _rejected;
+};
+
+#endif  // __WORKER_POOL_H__
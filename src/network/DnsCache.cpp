@@ -0,0 +1,147 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#include "DnsCache.h"
+#include <algorithm>
+
+namespace network
+{
+
+DnsCache::DnsCache(ResolveFunc resolver)
+    : _resolver(std::move(resolver))
+    , _generation(0)
+    , _ttl(DEFAULT_TTL)
+    , _negativeTTL(DEFAULT_NEGATIVE_TTL)
+{}
+
+int DnsCache::resolve(std::vector<yasio::inet::ip::endpoint>& endpoints, const char* hostname, unsigned short port)
+{
+    std::unique_lock<std::mutex> lck(_mutex);
+
+    // entries are never erased while resolving or waited on, and unordered_map keeps references stable
+    auto& entry = _entries[hostname];
+    ++entry.uses;
+    if (entry.resolving)
+    {
+        ++entry.waiters;
+        while (entry.resolving)
+            _resolvedCond.wait(lck);
+        --entry.waiters;
+    }
+
+    if (entry.generation == _generation && std::chrono::steady_clock::now() < entry.expireTime)
+    {
+        endpoints = entry.endpoints;
+        for (auto& ep : endpoints)
+            ep.port(port);
+        return entry.error;
+    }
+
+    entry.resolving = true;
+    auto generation = _generation;
+    lck.unlock();
+
+    std::vector<yasio::inet::ip::endpoint> resolved;
+    int error = _resolver(resolved, hostname, port);
+    if (error == 0 && resolved.empty())
+        error = -1;
+
+    lck.lock();
+    entry.resolving  = false;
+    entry.error      = error;
+    entry.endpoints  = resolved;
+    entry.generation = generation;  // stale if clear() was called meanwhile
+    entry.expireTime = std::chrono::steady_clock::now() + (error == 0 ? _ttl : _negativeTTL);
+    _resolvedCond.notify_all();
+    lck.unlock();
+
+    endpoints = std::move(resolved);
+    return error;
+}
+
+void DnsCache::clear()
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    ++_generation;
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+        if (!it->second.resolving && it->second.waiters == 0)
+            it = _entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+std::vector<DnsCache::Record> DnsCache::getRecords()
+{
+    std::vector<Record> records;
+
+    std::lock_guard<std::mutex> lck(_mutex);
+    auto steadyNow = std::chrono::steady_clock::now();
+    auto systemNow = std::chrono::system_clock::now();
+    for (auto&& item : _entries)
+    {
+        auto& entry = item.second;
+        if (entry.resolving || entry.error != 0 || entry.endpoints.empty())
+            continue;
+        auto expireTime = systemNow + std::chrono::duration_cast<std::chrono::system_clock::duration>(entry.expireTime - steadyNow);
+        records.push_back(Record{item.first, entry.endpoints, expireTime, entry.uses});
+    }
+    std::sort(records.begin(), records.end(), [](const Record& lhs, const Record& rhs) { return lhs.uses > rhs.uses; });
+    return records;
+}
+
+void DnsCache::addRecords(const std::vector<Record>& records)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    auto steadyNow = std::chrono::steady_clock::now();
+    auto systemNow = std::chrono::system_clock::now();
+    for (auto&& record : records)
+    {
+        auto& entry = _entries[record.host];
+        if (entry.resolving)
+            continue;
+        entry.uses += record.uses;
+        if (record.expireTime <= systemNow || record.endpoints.empty())
+            continue;
+        entry.endpoints  = record.endpoints;
+        entry.error      = 0;
+        entry.generation = _generation;
+        entry.expireTime = steadyNow + std::chrono::duration_cast<std::chrono::steady_clock::duration>(record.expireTime - systemNow);
+    }
+}
+
+void DnsCache::setTTL(int value)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    _ttl = std::chrono::seconds(value);
+}
+
+void DnsCache::setNegativeTTL(int value)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    _negativeTTL = std::chrono::seconds(value);
+}
+
+}  // namespace network
@@ -0,0 +1,136 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef __HTTP_DNS_CACHE_H__
+#define __HTTP_DNS_CACHE_H__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include "xxsocket.hpp"
+
+/**
+ * @addtogroup network
+ * @{
+ */
+
+namespace network
+{
+
+/**
+ * A host-keyed name resolution cache shared by all channels of HttpClient.
+ *
+ * Successful lookups are kept for the TTL, failed ones for the negative TTL, and concurrent
+ * lookups of the same host wait for the single query already in flight.
+ *
+ * @lua NA
+ */
+class DnsCache
+{
+public:
+    typedef std::function<int(std::vector<yasio::inet::ip::endpoint>&, const char*, unsigned short)> ResolveFunc;
+
+    struct Record
+    {
+        std::string host;
+        std::vector<yasio::inet::ip::endpoint> endpoints;
+        std::chrono::system_clock::time_point expireTime;
+        unsigned int uses;
+    };
+
+    static constexpr int DEFAULT_TTL          = 600;  // in seconds
+    static constexpr int DEFAULT_NEGATIVE_TTL = 5;    // in seconds
+
+    /**
+     * @param resolver the blocking resolver to query on cache miss, such as io_service::resolve.
+     */
+    explicit DnsCache(ResolveFunc resolver);
+
+    /**
+     * Resolve the host, compatible with yasio::resolv_fn_t.
+     * May block while another thread is querying the same host.
+     *
+     * @return 0 on success, otherwise the error of the resolver.
+     */
+    int resolve(std::vector<yasio::inet::ip::endpoint>& endpoints, const char* hostname, unsigned short port);
+
+    /**
+     * Drop all cached addresses, queries in flight won't be cached.
+     */
+    void clear();
+
+    /**
+     * Get the successfully resolved hosts, the most used first.
+     */
+    std::vector<Record> getRecords();
+
+    /**
+     * Add hosts resolved before, such as by the last launch.
+     * The expired ones only keep their use count, the next lookup of them queries the resolver.
+     */
+    void addRecords(const std::vector<Record>& records);
+
+    /**
+     * Set how long a successful lookup is reused, in seconds.
+     */
+    void setTTL(int value);
+
+    /**
+     * Set how long a failed lookup is reported without asking the resolver again, in seconds.
+     */
+    void setNegativeTTL(int value);
+
+private:
+    struct Entry
+    {
+        std::vector<yasio::inet::ip::endpoint> endpoints;
+        int error = 0;
+        unsigned int uses = 0;
+        bool resolving = false;
+        unsigned int waiters = 0;  // threads waiting for the resolving one, they keep a reference to the entry
+        unsigned int generation = 0;
+        std::chrono::steady_clock::time_point expireTime;
+    };
+
+    ResolveFunc _resolver;
+
+    std::mutex _mutex;
+    std::condition_variable _resolvedCond;
+    std::unordered_map<std::string, Entry> _entries;
+    unsigned int _generation;
+
+    std::chrono::seconds _ttl;
+    std::chrono::seconds _negativeTTL;
+};
+
+}  // namespace network
+
+// end group
+/// @}
+
+#endif  //__HTTP_DNS_CACHE_H__
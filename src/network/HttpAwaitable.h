@@ -0,0 +1,128 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef __HTTP_AWAITABLE_H__
+#define __HTTP_AWAITABLE_H__
+
+#include "HttpClient.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#    include <coroutine>
+#    include <exception>
+#    include "../base/Director.h"
+#    include "../base/RefPtr.h"
+
+/**
+ * @addtogroup network
+ * @{
+ */
+
+namespace network
+{
+
+/**
+ * The awaitable returned by HttpClient::fetch, it sends the request when awaited and resumes the coroutine
+ * with the response on the chosen thread. The response callback of the request is not invoked.
+ *
+ * It lives in the coroutine frame and is resumed from HttpClient::finishResponse directly, so awaiting
+ * allocates nothing besides the response itself.
+ *
+ * @lua NA
+ */
+class HttpFetchAwaitable
+{
+public:
+    HttpFetchAwaitable(HttpClient* client, HttpRequest* request, HttpResumeOn resumeOn)
+        : _client(client), _request(request), _resumeOn(resumeOn)
+    {}
+
+    bool await_ready() const noexcept { return _request == nullptr; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        _handle = handle;
+        // the hook is kept on the response of this send, so the request may be fetched by several coroutines,
+        // it may resume at once, don't touch this afterwards
+        _client->sendWithCompletionHook(_request, &HttpFetchAwaitable::onComplete, this);
+    }
+
+    /**
+     * @return the response, nullptr if the request was nullptr.
+     */
+    RefPtr<HttpResponse> await_resume() noexcept { return RefPtr<HttpResponse>(ReferencedObject<HttpResponse>{_response}); }
+
+private:
+    static void onComplete(void* context, HttpResponse* response)
+    {
+        auto thiz       = static_cast<HttpFetchAwaitable*>(context);
+        thiz->_response = response;
+        if (thiz->_resumeOn == HttpResumeOn::NETWORK_THREAD)
+            thiz->_handle.resume();
+        else
+            Director::getInstance()->getScheduler()->runOnAxmolThread([handle = thiz->_handle] { handle.resume(); });
+    }
+
+    HttpClient* _client;
+    HttpRequest* _request;
+    HttpResumeOn _resumeOn;
+    std::coroutine_handle<> _handle;
+    HttpResponse* _response = nullptr;
+};
+
+inline HttpFetchAwaitable HttpClient::fetch(HttpRequest* request, HttpResumeOn resumeOn)
+{
+    return HttpFetchAwaitable{this, request, resumeOn};
+}
+
+/**
+ * A fire-and-forget coroutine type to co_await HttpClient::fetch in, it starts at once and frees itself
+ * when it returns:
+ *
+ *     network::HttpTask downloadLevel(int id)
+ *     {
+ *         auto search = co_await client->fetch(searchRequest, network::HttpResumeOn::NETWORK_THREAD);
+ *         auto level  = co_await client->fetch(makeLevelRequest(search.get()));
+ *         ...
+ *     }
+ */
+struct HttpTask
+{
+    struct promise_type
+    {
+        HttpTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+}  // namespace network
+
+// end group
+/// @}
+
+#endif  // __cpp_impl_coroutine
+
+#endif  //__HTTP_AWAITABLE_H__
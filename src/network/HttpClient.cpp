@@ -27,7 +27,16 @@
  ****************************************************************************/
 
 #include "HttpClient.h"
+#include "DnsCache.h"
+#include "TlsSessionCache.h"
+#include "LatencyTracker.h"
 #include <errno.h>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
 #include "../base/Utils.h"
 #include "../base/Director.h"
 #include "yasio.hpp"
@@ -59,6 +68,33 @@ static void __clearQueueUnsafe(_Cont& queue, _Fty pred)
     }
 }
 
+static int __openFileRegion(std::string_view path,
+                            int64_t offset,
+                            int64_t length,
+                            ccHttpRequestDataProducer& producer,
+                            int64_t& size)
+{
+    auto file = std::make_shared<std::ifstream>(std::string{path}, std::ios::binary);
+    if (!file->is_open())
+        return ENOENT;
+
+    file->seekg(0, std::ios::end);
+    int64_t fileSize = static_cast<int64_t>(file->tellg());
+    if (offset < 0 || offset > fileSize)
+        return EINVAL;
+    if (length < 0 || length > fileSize - offset)
+        length = fileSize - offset;
+    file->seekg(offset, std::ios::beg);
+
+    size     = length;
+    producer = [file](char* buffer, int size) -> int {
+        if (!file->read(buffer, size) && !file->eof())
+            return -1;
+        return static_cast<int>(file->gcount());
+    };
+    return 0;
+}
+
 // HttpClient implementation
 HttpClient* HttpClient::getInstance()
 {
@@ -77,6 +113,7 @@ void HttpClient::destroyInstance()
         return;
     }
 
+    _httpClient->saveWarmupSnapshot();
     delete _httpClient;
     _httpClient = nullptr;
 }
@@ -90,9 +127,16 @@ void HttpClient::setSSLVerification(std::string_view caFile)
 
 HttpClient::HttpClient()
     : _isInited(false)
+    , _hedgingBudget(10)
+    , _hedgeCandidates(0)
+    , _hedgesSent(0)
+    , _hedgesWon(0)
     , _dispatchOnWorkThread(false)
+    , _discardPoolCallbacks(false)
+    , _dispatchTimeBudget(4)
     , _timeoutForConnect(30)
     , _timeoutForRead(60)
+    , _timeoutForTotal(0)
     , _clearResponsePredicate(nullptr)
 {
     _scheduler = Director::getInstance()->getScheduler();
@@ -101,6 +145,28 @@ HttpClient::HttpClient()
     _service->set_option(yasio::YOPT_S_FORWARD_PACKET, 1); // forward packet immediately when got data from OS kernel
     _service->set_option(yasio::YOPT_S_DNS_QUERIES_TIMEOUT, 3);
     _service->set_option(yasio::YOPT_S_DNS_QUERIES_TRIES, 1);
+    _service->set_option(yasio::YOPT_S_DNS_RESOLV_THREADS, 2); // few hosts, so a tiny pool is enough
+    _service->set_option(yasio::YOPT_S_CONNECT_ATTEMPT_DELAYMS, 250); // race the resolved addresses, RFC 8305
+
+    // all channels share one cache, so a burst to the same host is resolved only once
+    _dnsCache = new DnsCache([this](std::vector<ip::endpoint>& eps, const char* host, unsigned short port) {
+        return _service->resolve(eps, host, port);
+    });
+    yasio::resolv_fn_t resolver = [this](std::vector<ip::endpoint>& eps, const char* host, unsigned short port) {
+        return _dnsCache->resolve(eps, host, port);
+    };
+    _service->set_option(yasio::YOPT_S_RESOLV_FN, &resolver);
+
+    // offer every new ssl channel the last session of its host
+    _tlsSessionCache = new TlsSessionCache();
+    yasio::ssl_session_load_fn_t loadSession = [this](const char* host) { return _tlsSessionCache->load(host); };
+    yasio::ssl_session_save_fn_t saveSession = [this](const char* host, std::string session) {
+        _tlsSessionCache->save(host, std::move(session));
+    };
+    _service->set_option(yasio::YOPT_S_SSL_SESSION_FN, &loadSession, &saveSession);
+
+    _latencyTracker = new LatencyTracker();
+    _metrics        = new HttpMetrics();
     _service->start([this](yasio::event_ptr&& e) { handleNetworkEvent(e.get()); });
 
     for (int i = 0; i < HttpClient::MAX_CHANNELS; ++i)
@@ -114,7 +180,18 @@ HttpClient::HttpClient()
 HttpClient::~HttpClient()
 {
     _scheduler->unscheduleAllForTarget(this);
-    delete _service;
+
+    // stop the pool before anything is torn down, its queued callbacks only release their response then,
+    // and it's stopped even if getWorkerPool shared it
+    _discardPoolCallbacks = true;
+    if (auto workerPool = std::atomic_exchange(&_workerPool, std::shared_ptr<WorkerPool>{}))
+        workerPool->stop();
+
+    delete _service;  // waits for the lookups in flight on its resolver threads, they use _dnsCache
+    delete _dnsCache;
+    delete _tlsSessionCache;
+    delete _latencyTracker;
+    delete _metrics;
 
     clearPendingResponseQueue();
     clearFinishedResponseQueue();
@@ -125,6 +202,9 @@ HttpClient::~HttpClient()
 
 void HttpClient::setDispatchOnWorkThread(bool bVal)
 {
+    // the queued callbacks are run while the pool stops
+    releaseWorkerPool(std::atomic_exchange(&_workerPool, std::shared_ptr<WorkerPool>{}));
+
     _scheduler->unscheduleAllForTarget(this);
     _dispatchOnWorkThread = bVal;
     if (!bVal)
@@ -132,24 +212,94 @@ void HttpClient::setDispatchOnWorkThread(bool bVal)
 }
 
 
+void HttpClient::setDispatchOnWorkerPool(int threadCount, int maxQueued)
+{
+    if (threadCount <= 0)
+    {
+        setDispatchOnWorkThread(false);
+        return;
+    }
+
+    // the old pool stops after running its queued callbacks
+    releaseWorkerPool(std::atomic_exchange(&_workerPool, std::make_shared<WorkerPool>(threadCount, maxQueued)));
+    if (_dispatchOnWorkThread)
+    {  // the responses of a full pool still go to the game thread
+        _dispatchOnWorkThread = false;
+        _scheduler->schedule([this](float) { tickInput(); }, this, 0, false, "#");
+    }
+}
+
+void HttpClient::releaseWorkerPool(std::shared_ptr<WorkerPool> workerPool)
+{
+    // called from a callback on the pool, its worker can't wait for itself, the game thread stops the pool
+    if (workerPool && workerPool->isWorkerThread())
+        _scheduler->runOnAxmolThread([workerPool] {});
+}
+
 // Poll and notify main thread if responses exists in queue
 void HttpClient::tickInput()
 {
     if (_finishedResponseQueue.unsafe_empty())
         return;
 
-    auto lck = _finishedResponseQueue.get_lock();
-    if (!_finishedResponseQueue.unsafe_empty())
+    // spread a burst of callbacks across frames, the queue is ordered by priority
+    using namespace std::chrono;
+    auto frameStart = steady_clock::now();
+    auto budget     = microseconds(static_cast<long long>(_dispatchTimeBudget * 1000));
+    auto now        = frameStart;
+    for (;;)
     {
+        auto lck = _finishedResponseQueue.get_lock();
+        if (_finishedResponseQueue.unsafe_empty())
+            break;
         HttpResponse* response = _finishedResponseQueue.front();
         _finishedResponseQueue.unsafe_pop_front();
         lck.unlock();
+
+        auto callbackStart = now;
         invokeResposneCallbackAndRelease(response);
+        now = steady_clock::now();
+
+        float callbackTime = duration<float, std::milli>(now - callbackStart).count();
+        _dispatchStats.maxCallbackTime = (std::max)(_dispatchStats.maxCallbackTime, callbackTime);
+        ++_dispatchStats.callbacks;
+        if (now - frameStart >= budget)
+            break;
     }
+
+    float frameTime              = duration<float, std::milli>(now - frameStart).count();
+    _dispatchStats.lastFrameTime = frameTime;
+    _dispatchStats.maxFrameTime  = (std::max)(_dispatchStats.maxFrameTime, frameTime);
+    _dispatchStats.totalTime += frameTime;
+    ++_dispatchStats.frames;
+    if (_dispatchTimeBudget > 0 && frameTime > _dispatchTimeBudget)
+        ++_dispatchStats.overBudget;
+    _dispatchStats.backlog = static_cast<unsigned int>(_finishedResponseQueue.size());
+}
+
+HttpMetrics::Snapshot HttpClient::getMetricsSnapshot()
+{
+    auto snapshot          = _metrics->snapshot();
+    snapshot.channels      = MAX_CHANNELS;
+    snapshot.channelsInUse = MAX_CHANNELS - static_cast<int>(_availChannelQueue.size());
+    {
+        std::lock_guard<std::recursive_mutex> lock(_warmChannelsMutex);
+        snapshot.warmChannels = static_cast<int>(_warmChannels.size());
+    }
+    snapshot.pendingRequests = static_cast<int>(_pendingResponseQueue.size());
+    snapshot.finishedBacklog = static_cast<int>(_finishedResponseQueue.size());
+    return snapshot;
+}
+
+bool HttpClient::dumpMetrics(std::string_view path)
+{
+    return getMetricsSnapshot().writeJson(path);
 }
 
 void HttpClient::handleNetworkStatusChanged()
 {
+    _dnsCache->clear();
+    _latencyTracker->clear();
     _service->set_option(YOPT_S_DNS_DIRTY, 1);
 }
 
@@ -158,6 +308,166 @@ void HttpClient::setNameServers(std::string_view servers)
     _service->set_option(YOPT_S_DNS_LIST, servers.data());
 }
 
+HttpHeaderTemplatePtr HttpClient::registerHeaderTemplate(std::string_view name,
+                                                         const std::vector<std::string>& headers)
+{
+    auto headerTemplate = std::make_shared<const HttpHeaderTemplate>(headers);
+
+    std::lock_guard<std::recursive_mutex> lock(_headerTemplatesMutex);
+    _headerTemplates[std::string{name}] = headerTemplate;
+    return headerTemplate;
+}
+
+HttpHeaderTemplatePtr HttpClient::getHeaderTemplate(std::string_view name)
+{
+    std::lock_guard<std::recursive_mutex> lock(_headerTemplatesMutex);
+    auto it = _headerTemplates.find(std::string{name});
+    return it != _headerTemplates.end() ? it->second : nullptr;
+}
+
+void HttpClient::unregisterHeaderTemplate(std::string_view name)
+{
+    std::lock_guard<std::recursive_mutex> lock(_headerTemplatesMutex);
+    _headerTemplates.erase(std::string{name});
+}
+
+HttpHeaderTemplatePtr HttpClient::acquireHeaderTemplate(const std::vector<std::string>& headers)
+{
+    auto hash = HttpHeaderTemplate::hashHeaders(headers);
+
+    std::lock_guard<std::recursive_mutex> lock(_headerTemplatesMutex);
+    auto it = _headerTemplatesByHash.find(hash);
+    if (it != _headerTemplatesByHash.end() && it->second->matches(headers))
+        return it->second;
+
+    // a miss or a hash collision, the colliding template is replaced by the newer header set
+    if (it == _headerTemplatesByHash.end() && _headerTemplatesByHash.size() >= MAX_HEADER_TEMPLATES)
+        _headerTemplatesByHash.clear();  // the header sets aren't fixed, don't grow forever
+    auto headerTemplate = std::make_shared<const HttpHeaderTemplate>(headers);
+    _headerTemplatesByHash[hash] = headerTemplate;
+    return headerTemplate;
+}
+
+void HttpClient::enableWarmupSnapshot(std::string_view snapshotFile, int preresolveCount, int preconnectCount)
+{
+    {
+        std::lock_guard<std::recursive_mutex> lock(_warmupSnapshotMutex);
+        _warmupSnapshotFilename = snapshotFile;
+    }
+    loadWarmupSnapshot(preresolveCount, preconnectCount);
+}
+
+std::string_view HttpClient::getWarmupSnapshotFilename()
+{
+    std::lock_guard<std::recursive_mutex> lock(_warmupSnapshotMutex);
+    return _warmupSnapshotFilename;
+}
+
+// The snapshot is a text file of tab separated lines:
+//   af   <address family>
+//   dns  <host> <expire time_t> <uses> <ip> [<ip>...]
+//   tls  <host> <save time_t> <base64 session>
+void HttpClient::loadWarmupSnapshot(int preresolveCount, int preconnectCount)
+{
+    std::unique_lock<std::recursive_mutex> lock(_warmupSnapshotMutex);
+    std::ifstream file(_warmupSnapshotFilename);
+    lock.unlock();
+    if (!file.is_open())
+        return;
+
+    std::vector<DnsCache::Record> records;
+    std::vector<TlsSessionCache::Record> sessions;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string tag;
+        fields >> tag;
+        if (tag == "af")
+        {
+            int af = 0;
+            if (fields >> af)
+                _service->set_option(YOPT_S_CONNECTED_AF, af);
+        }
+        else if (tag == "dns")
+        {
+            DnsCache::Record record;
+            time_t expireTime = 0;
+            if (!(fields >> record.host >> expireTime >> record.uses))
+                continue;
+            record.expireTime = std::chrono::system_clock::from_time_t(expireTime);
+            std::string ip;
+            while (fields >> ip)
+            {
+                ip::endpoint ep(ip.c_str(), 0);
+                if (ep)
+                    record.endpoints.push_back(ep);
+            }
+            records.push_back(std::move(record));
+        }
+        else if (tag == "tls")
+        {
+            TlsSessionCache::Record session;
+            time_t saveTime = 0;
+            std::string encoded;
+            if (!(fields >> session.host >> saveTime >> encoded))
+                continue;
+            session.session  = utilsX::base64Decode(encoded);
+            session.saveTime = std::chrono::system_clock::from_time_t(saveTime);
+            sessions.push_back(std::move(session));
+        }
+    }
+
+    _dnsCache->addRecords(records);
+    _tlsSessionCache->addRecords(sessions);
+
+    // records are saved the most used first
+    auto warmCount = static_cast<size_t>((std::max)((std::max)(preresolveCount, preconnectCount), 0));
+    if (records.size() > warmCount)
+        records.resize(warmCount);
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        auto& host = records[i].host;
+        if (i < static_cast<size_t>(preconnectCount))
+        {  // the channel resolves the host itself, a host with a TLS session was reached over https
+            bool secure = std::any_of(sessions.begin(), sessions.end(),
+                                      [&host](const TlsSessionCache::Record& session) { return session.host == host; });
+            preconnect((secure ? "https://" : "http://") + host);
+        }
+        else  // the resolver threads of the service fill the DnsCache
+            _service->prefetch(host.c_str());
+    }
+}
+
+void HttpClient::saveWarmupSnapshot()
+{
+    // held until the file is written, so two saves can't interleave
+    std::lock_guard<std::recursive_mutex> lock(_warmupSnapshotMutex);
+    if (_warmupSnapshotFilename.empty())
+        return;
+    std::ofstream file(_warmupSnapshotFilename, std::ios::trunc);
+    if (!file.is_open())
+    {
+        AXLOG("HttpClient: can't save warm-up snapshot");
+        return;
+    }
+
+    if (int af = _service->connected_af())
+        file << "af\t" << af << '\n';
+    for (auto&& record : _dnsCache->getRecords())
+    {
+        file << "dns\t" << record.host << '\t' << std::chrono::system_clock::to_time_t(record.expireTime) << '\t'
+             << record.uses;
+        for (auto&& ep : record.endpoints)
+            file << '\t' << ep.ip();
+        file << '\n';
+    }
+    // the sessions are resumption secrets in plain text, only the recent ones are kept, see TlsSessionCache::getRecords
+    for (auto&& session : _tlsSessionCache->getRecords())
+        file << "tls\t" << session.host << '\t' << std::chrono::system_clock::to_time_t(session.saveTime) << '\t'
+             << utilsX::base64Encode(session.session) << '\n';
+}
+
 yasio::io_service* HttpClient::getInternalService()
 {
     return _service;
@@ -168,11 +478,115 @@ bool HttpClient::send(HttpRequest* request)
     if (!request)
         return false;
 
+    auto response = createResponse(request);
+    processResponse(response, -1);
+    response->release();
+    return true;
+}
+
+HttpResponse* HttpClient::createResponse(HttpRequest* request)
+{
     auto response = new HttpResponse(request);
+    response->_stats.createTime = yasio::highp_clock();
     response->setLocation(request->getUrl(), false);
+    return response;
+}
+
+int HttpClient::sendBatch(HttpRequest* const* requests, size_t count)
+{
+    // validate all the uris first, the invalid ones are finished at once,
+    // the reference of every new response is handed to its channel or the pending queue.
+    std::vector<HttpResponse*> responses;
+    responses.reserve(count);
+    int sent = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!requests[i])
+            continue;
+        ++sent;
+        auto response = createResponse(requests[i]);
+        if (!response->validateUri())
+            finishResponse(response);
+        else if (!tryTakeWarmChannel(response))
+            responses.emplace_back(response);
+    }
+    if (responses.empty())
+        return sent;
+
+    // take the free channels in bulk and open them with a single wakeup
+    std::vector<std::pair<int, int>> channels;
+    {
+        auto lck = _availChannelQueue.get_lock();
+        while (channels.size() < responses.size() && !_availChannelQueue.unsafe_empty())
+        {
+            channels.emplace_back(_availChannelQueue.unsafe_front(), 0);
+            _availChannelQueue.unsafe_pop_front();
+        }
+    }
+    for (size_t i = 0; i < channels.size(); ++i)
+        channels[i].second = prepareChannel(responses[i], channels[i].first);
+    if (!channels.empty())
+        _service->open(channels.data(), channels.size());
+
+    if (channels.size() < responses.size())
+    {
+        {
+            auto lck = _pendingResponseQueue.get_lock();
+            for (size_t i = channels.size(); i < responses.size(); ++i)
+                _pendingResponseQueue.unsafe_emplace_back(responses[i]);
+        }
+        evictWarmChannel();
+    }
+    return sent;
+}
+
+std::future<HttpResponse*> HttpClient::send(HttpRequest* request, UseFuture)
+{
+    if (!request)
+    {
+        std::promise<HttpResponse*> promise;
+        promise.set_value(nullptr);
+        return promise.get_future();
+    }
+
+    return sendWithFuture(request, std::make_shared<HttpResponse::SyncState>());
+}
+
+std::future<HttpResponse*> HttpClient::sendWithFuture(HttpRequest* request,
+                                                      std::shared_ptr<HttpResponse::SyncState> syncState)
+{
+    // the state belongs to this send only, the request can be sent again in any way meanwhile
+    auto future          = syncState->promise.get_future();
+    auto response        = createResponse(request);
+    response->_syncState = std::move(syncState);
     processResponse(response, -1);
     response->release();
-    return true;
+    return future;
+}
+
+void HttpClient::sendWithCompletionHook(HttpRequest* request, HttpResponse::CompletionHook hook, void* context)
+{
+    auto response                    = createResponse(request);
+    response->_completionHook        = hook;
+    response->_completionHookContext = context;
+    processResponse(response, -1);
+    response->release();
+}
+
+HttpResponse* HttpClient::sendSync(HttpRequest* request, int timeoutMs)
+{
+    if (!request)
+        return nullptr;
+
+    auto syncState = std::make_shared<HttpResponse::SyncState>();
+    auto future    = sendWithFuture(request, syncState);
+    if (timeoutMs < 0 || future.wait_for(std::chrono::milliseconds(timeoutMs)) == std::future_status::ready)
+        return future.get();
+
+    // give up waiting, unless the response was finished meanwhile
+    if (syncState->status.exchange(HttpResponse::SyncState::ABANDONED) == HttpResponse::SyncState::FINISHED)
+        return future.get();
+    return nullptr;
 }
 
 int HttpClient::tryTakeAvailChannel()
@@ -187,40 +601,263 @@ int HttpClient::tryTakeAvailChannel()
     return -1;
 }
 
+void HttpClient::recycleChannel(int channelIndex)
+{
+    // try process pending response
+    auto lck = _pendingResponseQueue.get_lock();
+    if (!_pendingResponseQueue.unsafe_empty())
+    {
+        auto pendingResponse = _pendingResponseQueue.unsafe_front();
+        _pendingResponseQueue.unsafe_pop_front();
+        lck.unlock();
+
+        processResponse(pendingResponse, channelIndex);
+        pendingResponse->release();
+    }
+    else
+    {  // recycle channel
+        _availChannelQueue.push_front(channelIndex);
+    }
+}
+
 void HttpClient::processResponse(HttpResponse* response, int channelIndex)
 {
     response->retain();
 
     if (response->validateUri())
     {
+        if (channelIndex == -1 && tryTakeWarmChannel(response))
+            return;
+
         if (channelIndex == -1)
             channelIndex = tryTakeAvailChannel();
 
         if (channelIndex != -1)
-        {
-            auto channelHandle = _service->channel_at(channelIndex);
-            auto& requestUri = response->getRequestUri();
-            channelHandle->ud_.ptr = response;
-            _service->set_option(YOPT_C_REMOTE_ENDPOINT, channelIndex, requestUri.getHost().data(),
-                                 (int)requestUri.getPort());
-            if (requestUri.isSecure())
-                _service->open(channelIndex, YCK_SSL_CLIENT);
-            else
-                _service->open(channelIndex, YCK_TCP_CLIENT);
-        }
+            openChannel(response, channelIndex);
         else
+        {
             _pendingResponseQueue.emplace_back(response);
+            evictWarmChannel();
+        }
     }
     else
         finishResponse(response);
 }
 
-void HttpClient::handleNetworkEvent(yasio::io_event* event)
+void HttpClient::openChannel(HttpResponse* response, int channelIndex)
+{
+    _service->open(channelIndex, prepareChannel(response, channelIndex));
+}
+
+int HttpClient::prepareChannel(HttpResponse* response, int channelIndex)
+{
+    recordChannelTaken(response, true);
+
+    auto channelHandle = _service->channel_at(channelIndex);
+    auto& requestUri = response->getRequestUri();
+    channelHandle->ud_.ptr = response;
+    _service->set_option(YOPT_C_REMOTE_ENDPOINT, channelIndex, requestUri.getHost().data(),
+                         (int)requestUri.getPort());
+    return requestUri.isSecure() ? YCK_SSL_CLIENT : YCK_TCP_CLIENT;
+}
+
+int HttpClient::preconnect(std::string_view url, int count)
+{
+    auto uri = Uri::parse(url);
+    if (!uri.isValid())
+        return 0;
+
+    int opened = 0;
+    for (; opened < count; ++opened)
+    {
+        int channelIndex = tryTakeAvailChannel();
+        if (channelIndex == -1)
+            break;
+
+        {
+            std::lock_guard<std::recursive_mutex> lock(_warmChannelsMutex);
+            _warmChannels[channelIndex] = WarmChannel{std::string{uri.getHost()}, (int)uri.getPort(), uri.isSecure(), nullptr};
+        }
+
+        _service->channel_at(channelIndex)->ud_.ptr = nullptr;
+        _service->set_option(YOPT_C_REMOTE_ENDPOINT, channelIndex, uri.getHost().data(), (int)uri.getPort());
+        _service->open(channelIndex, uri.isSecure() ? YCK_SSL_CLIENT : YCK_TCP_CLIENT);
+    }
+    return opened;
+}
+
+void HttpClient::recordChannelTaken(HttpResponse* response, bool opening)
+{
+    auto now    = yasio::highp_clock();
+    auto& stats = response->_stats;
+    if (!stats.queueRecorded)
+    {
+        _metrics->recordLatency(HttpMetrics::Latency::QUEUE_WAIT, now - stats.createTime);
+        stats.queueRecorded = true;
+    }
+    stats.openTime = opening ? now : 0;
+}
+
+bool HttpClient::tryTakeWarmChannel(HttpResponse* response)
+{
+    auto& requestUri = response->getRequestUri();
+    int channelIndex = -1;
+    yasio::transport_handle_t transport = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_warmChannelsMutex);
+        for (auto it = _warmChannels.begin(); it != _warmChannels.end(); ++it)
+        {
+            auto& warm = it->second;
+            if (warm.transport && warm.port == requestUri.getPort() && warm.secure == requestUri.isSecure() &&
+                warm.host == requestUri.getHost())
+            {
+                channelIndex = it->first;
+                transport    = warm.transport;
+                _warmChannels.erase(it);
+                break;
+            }
+        }
+    }
+    if (channelIndex == -1)
+        return false;
+
+    // hand off on the network thread, where the warm connection may be closing meanwhile
+    _service->schedule(std::chrono::microseconds(0), [this, channelIndex, response, transport](io_service& s) {
+        auto channel = s.channel_at(channelIndex);
+        channel->get_user_timer().cancel();
+        if (s.is_open(channelIndex))
+        {
+            channel->ud_.ptr = response;
+            recordChannelTaken(response, false);
+            startRequest(response, channel, transport);
+        }
+        else
+            openChannel(response, channelIndex);
+        return true;
+    });
+    return true;
+}
+
+void HttpClient::evictWarmChannel()
+{
+    std::lock_guard<std::recursive_mutex> lock(_warmChannelsMutex);
+    for (auto&& item : _warmChannels)
+    {
+        if (item.second.transport)
+        {  // the close event recycles it to the pending response, it can't be taken meanwhile
+            item.second.transport = nullptr;
+            _service->close(item.first);
+            break;
+        }
+    }
+}
+
+void HttpClient::handleWarmChannelEvent(yasio::io_event* event)
 {
     int channelIndex = event->cindex();
+    auto channel = _service->channel_at(channelIndex);
+
+    std::unique_lock<std::recursive_mutex> lock(_warmChannelsMutex);
+    auto it = _warmChannels.find(channelIndex);
+    if (it == _warmChannels.end())
+        return;  // taken by a request, which is handed the channel on this thread later
+
+    switch (event->kind())
+    {
+    case YEK_ON_OPEN:
+        if (event->status() == 0)
+        {
+            if (it->second.secure)
+                _tlsSessionCache->recordHandshake(io_service::ssl_session_reused(event->transport()));
+            it->second.transport = event->transport();
+
+            auto& timerForIdle = channel->get_user_timer();
+            timerForIdle.cancel();
+            timerForIdle.expires_from_now(std::chrono::seconds(WARM_CONNECTION_TIMEOUT));
+            timerForIdle.async_wait([this, channelIndex](io_service& s) {
+                std::lock_guard<std::recursive_mutex> lock(_warmChannelsMutex);
+                auto it = _warmChannels.find(channelIndex);
+                if (it != _warmChannels.end() && it->second.transport)
+                {  // unused
+                    it->second.transport = nullptr;
+                    s.close(channelIndex);
+                }
+                return true;
+            });
+            break;
+        }
+        [[fallthrough]];  // failed to connect, recycle it like a closed one
+    case YEK_ON_CLOSE:
+        channel->get_user_timer().cancel();
+        _warmChannels.erase(it);
+        lock.unlock();
+        recycleChannel(channelIndex);
+        break;
+    default:;  // nothing is expected before a request
+    }
+}
+
+void HttpClient::startRequest(HttpResponse* response, yasio::io_channel* channel, yasio::transport_handle_t transport)
+{
+    auto request          = response->getHttpRequest();
+    long long idleTimeout = request->getTimeoutForIdle();
+    if (idleTimeout < 0)
+        idleTimeout = getTimeoutForRead() * 1000LL;
+    long long totalTimeout = request->getTimeoutForTotal();
+    if (totalTimeout < 0)
+        totalTimeout = getTimeoutForTotal() * 1000LL;
+
+    auto now                    = yasio::clock();
+    long long deadline          = totalTimeout > 0 ? now + totalTimeout : 0;
+    response->_lastActivityTime = now;
+    response->_sendTime         = now;
+    response->_stats.sendTime   = yasio::highp_clock();
+    response->_stats.firstByte  = false;
+
+    sendRequest(response, transport);
+    armHedge(response, channel->index());
+
+    auto& timerForRead = channel->get_user_timer();
+    timerForRead.cancel();
+    if (idleTimeout <= 0 && deadline == 0)
+        return;
+
+    // the milliseconds until the nearest deadline, the received bytes only stamp the activity time,
+    // the timer catches up with it when it fires, instead of being re-armed for every packet.
+    auto nextWait = [=]() {
+        auto now       = yasio::clock();
+        long long wait = (std::numeric_limits<long long>::max)();
+        if (idleTimeout > 0)
+            wait = response->_lastActivityTime + idleTimeout - now;
+        if (deadline > 0)
+            wait = (std::min)(wait, deadline - now);
+        return wait;
+    };
+
+    int channelIndex = channel->index();
+    timerForRead.expires_from_now(std::chrono::milliseconds(nextWait()));
+    timerForRead.async_wait([=](io_service& s) {
+        auto wait = nextWait();
+        if (wait > 0)
+        {
+            s.channel_at(channelIndex)->get_user_timer().expires_from_now(std::chrono::milliseconds(wait));
+            return false;  // wait again
+        }
+        response->updateInternalCode(yasio::errc::read_timeout);
+        s.close(channelIndex);  // timeout
+        return true;
+    });
+}
+
+void HttpClient::handleNetworkEvent(yasio::io_event* event)
+{
     auto channel = _service->channel_at(event->cindex());
     HttpResponse* response = (HttpResponse*)channel->ud_.ptr;
-    assert(response);
+    if (!response)
+    {
+        handleWarmChannelEvent(event);
+        return;
+    }
 
     bool responseFinished = response->isFinished();
     switch (event->kind())
@@ -228,8 +865,22 @@ void HttpClient::handleNetworkEvent(yasio::io_event* event)
     case YEK_ON_PACKET:
         if (!responseFinished)
         {
+            response->_lastActivityTime = yasio::clock();
+            bool headersComplete        = response->_headersComplete;
             auto&& pkt = event->packet_view();
+            response->_stats.bytesIn += pkt.size();
+            if (!response->_stats.firstByte)
+            {
+                response->_stats.firstByte = true;
+                _metrics->recordLatency(HttpMetrics::Latency::TTFB, yasio::highp_clock() - response->_stats.sendTime);
+            }
             response->handleInput(pkt.data(), pkt.size());
+            if (!headersComplete && response->_headersComplete)
+            {
+                _latencyTracker->record(response->getRequestUri().getHost(),
+                                        static_cast<int>(response->_lastActivityTime - response->_sendTime));
+                settleHedge(response, true);
+            }
         }
         if (response->isFinished())
         {
@@ -240,124 +891,312 @@ void HttpClient::handleNetworkEvent(yasio::io_event* event)
     case YEK_ON_OPEN:
         if (event->status() == 0)
         {
-            obstream obs;
-            bool usePostData = false;
-            auto request = response->getHttpRequest();
-            switch (request->getRequestType())
+            if (response->getRequestUri().isSecure())
+                _tlsSessionCache->recordHandshake(io_service::ssl_session_reused(event->transport()));
+
+            if (response->_stats.openTime)
             {
-            case HttpRequest::Type::GET:
-                obs.write_bytes("GET");
-                break;
-            case HttpRequest::Type::POST:
-                obs.write_bytes("POST");
-                usePostData = true;
-                break;
-            case HttpRequest::Type::DELETE:
-                obs.write_bytes("DELETE");
-                break;
-            case HttpRequest::Type::PUT:
-                obs.write_bytes("PUT");
-                usePostData = true;
-                break;
-            default:
-                obs.write_bytes("GET");
-                break;
+                _metrics->recordLatency(HttpMetrics::Latency::CONNECT, yasio::highp_clock() - response->_stats.openTime);
+                response->_stats.openTime = 0;
             }
-            obs.write_bytes(" ");
 
-            auto& uri = response->getRequestUri();
-            obs.write_bytes(uri.getPathEtc());
+            if (response->_hedge.lost)
+                _service->close(event->transport());  // the peer won while connecting
+            else
+                startRequest(response, channel, event->transport());
+        }
+        else
+        {
+            handleNetworkEOF(response, channel, event->status());
+        }
+        break;
+    case YEK_ON_CLOSE:
+        handleNetworkEOF(response, channel, event->status());
+        break;
+    }
+}
+
+
+void HttpClient::sendRequest(HttpResponse* response, yasio::transport_handle_t transport)
+{
+    obstream obs;
+    bool usePostData = false;
+    auto request = response->getHttpRequest();
+    switch (request->getRequestType())
+    {
+    case HttpRequest::Type::GET:
+        obs.write_bytes("GET");
+        break;
+    case HttpRequest::Type::POST:
+        obs.write_bytes("POST");
+        usePostData = true;
+        break;
+    case HttpRequest::Type::DELETE:
+        obs.write_bytes("DELETE");
+        break;
+    case HttpRequest::Type::PUT:
+        obs.write_bytes("PUT");
+        usePostData = true;
+        break;
+    default:
+        obs.write_bytes("GET");
+        break;
+    }
+    obs.write_bytes(" ");
+
+    auto& uri = response->getRequestUri();
+    obs.write_bytes(uri.getPathEtc());
+
+    obs.write_bytes(" HTTP/1.1\r\n");
+
+    obs.write_bytes("Host: ");
+    obs.write_bytes(uri.getHost());
+    obs.write_bytes("\r\n");
+
+    // the fixed header block is serialized once, only splice it
+    int headerFlags = 0;
+    auto& headerTemplate = request->getHeaderTemplate();
+    if (headerTemplate)
+    {
+        obs.write_bytes(headerTemplate->getBytes());
+        headerFlags = headerTemplate->getFlags();
+    }
+
+    // process custom headers
+    using HeaderFlag = HttpHeaderTemplate::HeaderFlag;
+    auto& headers = request->getHeaders();
+    for (auto&& header : headers)
+    {
+        obs.write_bytes(header);
+        obs.write_bytes("\r\n");
+        headerFlags |= HttpHeaderTemplate::scanHeaderFlag(header);
+    }
+
+    if (!(headerFlags & HeaderFlag::USER_AGENT))
+        obs.write_bytes("User-Agent: \r\n");
+
+    if (!(headerFlags & HeaderFlag::ACCEPT))
+        obs.write_bytes("Accept: */*;q=0.8\r\n");
+
+    // the streamed request body: a file region opened on the network thread, or the producer
+    ccHttpRequestDataProducer producer;
+    int64_t producerSize = -1;
+    if (usePostData && !request->getRequestFilePath().empty())
+    {
+        int error = __openFileRegion(request->getRequestFilePath(), request->getRequestFileOffset(),
+                                     request->getRequestFileLength(), producer, producerSize);
+        if (error != 0)
+        {
+            AXLOG("HttpClient: open request data file %s failed, ec=%d", request->getRequestFilePath().data(), error);
+            response->updateInternalCode(error);
+            _service->close(transport);
+            return;
+        }
+    }
+    else if (usePostData && request->getRequestDataProducer())
+    {
+        producer     = request->getRequestDataProducer();
+        producerSize = request->getRequestDataProducerSize();
+    }
 
-            obs.write_bytes(" HTTP/1.1\r\n");
+    auto requestData     = request->getRequestData();
+    auto requestDataSize = static_cast<size_t>(request->getRequestDataSize());
+    if (usePostData)
+    {
+        if (!(headerFlags & HeaderFlag::CONTENT_TYPE))
+            obs.write_bytes("Content-Type: application/x-www-form-urlencoded;charset=UTF-8\r\n");
 
-            obs.write_bytes("Host: ");
-            obs.write_bytes(uri.getHost());
+        if (producer && producerSize < 0)
+            obs.write_bytes("Transfer-Encoding: chunked\r\n");
+        else
+        {
+            char strContentLength[32];
+            auto contentLength = producer ? static_cast<unsigned long long>(producerSize)
+                                          : static_cast<unsigned long long>(requestDataSize);
+            auto result = std::to_chars(strContentLength, strContentLength + sizeof(strContentLength), contentLength);
+            obs.write_bytes("Content-Length: ");
+            obs.write_bytes(cxx17::string_view{strContentLength, static_cast<size_t>(result.ptr - strContentLength)});
             obs.write_bytes("\r\n");
+        }
+    }
+    obs.write_bytes("\r\n");
 
-            // process custom headers
-            struct HeaderFlag
-            {
-                enum
-                {
-                    UESR_AGENT = 1,
-                    CONTENT_TYPE = 1 << 1,
-                    ACCEPT = 1 << 2,
-                };
-            };
-            int headerFlags = 0;
-            auto& headers = request->getHeaders();
-            if (!headers.empty())
-            {
-                using namespace cxx17;  // for string_view literal
-                for (auto&& header : headers)
-                {
-                    obs.write_bytes(header);
-                    obs.write_bytes("\r\n");
-
-                    if (cxx20::ic::starts_with(cxx17::string_view{ header }, "User-Agent:"_sv))
-                        headerFlags |= HeaderFlag::UESR_AGENT;
-                    else if (cxx20::ic::starts_with(cxx17::string_view{ header }, "Content-Type:"_sv))
-                        headerFlags |= HeaderFlag::CONTENT_TYPE;
-                    else if (cxx20::ic::starts_with(cxx17::string_view{ header }, "Accept:"_sv))
-                        headerFlags |= HeaderFlag::ACCEPT;
-                }
-            }
+    if (producer)
+    {
+        auto& upload     = response->_upload;
+        upload.producer         = std::move(producer);
+        upload.size             = producerSize;
+        upload.bytesQueued      = 0;
+        upload.chunked          = producerSize < 0;
+        upload.lastProgressTime = 0;
+
+        response->_stats.bytesOut += obs.buffer().size();
+        _service->write(transport, std::move(obs.buffer()));
+        pumpRequestData(response, transport);
+        return;
+    }
 
-            if (!(headerFlags & HeaderFlag::UESR_AGENT))
-                obs.write_bytes("User-Agent: \r\n");
+    // gather write: the body is sent right after the head without being merged into it,
+    // the response holds the request until the channel is closed.
+    std::vector<io_send_buffer> buffers;
+    response->_stats.bytesOut += obs.buffer().size();
+    buffers.emplace_back(std::move(obs.buffer()));
+    bool hasRequestData = usePostData && requestData && requestDataSize > 0;
+    if (hasRequestData)
+        response->_stats.bytesOut += requestDataSize;
+    if (hasRequestData && (request->getUploadProgressCallback() || requestDataSize > UPLOAD_CHUNK_SIZE))
+    {
+        // send the body in slices, each written slice reports the progress and refreshes the idle timeout
+        _service->writev(transport, std::move(buffers));
+        response->_upload.lastProgressTime = 0;
+        for (size_t offset = 0; offset < requestDataSize; offset += UPLOAD_CHUNK_SIZE)
+        {
+            auto bytesSent = (std::min)(requestDataSize, offset + UPLOAD_CHUNK_SIZE);
+            _service->forward(transport, requestData + offset, bytesSent - offset,
+                              [this, response, bytesSent, requestDataSize](int error, size_t) {
+                                  if (error == 0)
+                                      reportUploadProgress(response, bytesSent, requestDataSize);
+                              });
+        }
+        return;
+    }
 
-            if (!(headerFlags & HeaderFlag::ACCEPT))
-                obs.write_bytes("Accept: */*;q=0.8\r\n");
+    if (hasRequestData)
+        buffers.emplace_back(requestData, requestDataSize);
+    _service->writev(transport, std::move(buffers), [=](int error, size_t) {
+        if (error == 0)
+            response->_lastActivityTime = yasio::clock();
+    });
+}
 
-            if (usePostData)
-            {
-                if (!(headerFlags & HeaderFlag::CONTENT_TYPE))
-                    obs.write_bytes("Content-Type: application/x-www-form-urlencoded;charset=UTF-8\r\n");
-
-                char strContentLength[128] = { 0 };
-                auto requestData = request->getRequestData();
-                auto requestDataSize = request->getRequestDataSize();
-                snprintf(strContentLength, sizeof(strContentLength), "Content-Length: %d\r\n\r\n",
-                    static_cast<int>(requestDataSize));
-                obs.write_bytes(strContentLength);
-
-                if (requestData && requestDataSize > 0)
-                    obs.write_bytes(cxx17::string_view{ requestData, static_cast<size_t>(requestDataSize) });
-            }
-            else
-            {
-                obs.write_bytes("\r\n");
-            }
+void HttpClient::pumpRequestData(HttpResponse* response, yasio::transport_handle_t transport)
+{
+    auto& upload = response->_upload;
+
+    int chunkSize = UPLOAD_CHUNK_SIZE;
+    if (upload.size >= 0)
+        chunkSize = static_cast<int>((std::min)(static_cast<int64_t>(chunkSize), upload.size - upload.bytesQueued));
 
-            _service->write(event->transport(), std::move(obs.buffer()));
+    yasio::sbyte_buffer chunk;
+    int n = 0;
+    if (chunkSize > 0)
+    {
+        chunk.resize(chunkSize);
+        n = upload.producer(chunk.data(), chunkSize);
+    }
 
-            auto& timerForRead = channel->get_user_timer();
-            timerForRead.cancel();
-            timerForRead.expires_from_now(std::chrono::seconds(this->_timeoutForRead));
-            timerForRead.async_wait([=](io_service& s) {
-                response->updateInternalCode(yasio::errc::read_timeout);
-                s.close(channelIndex);  // timeout
+    if (n == HttpRequest::REQUEST_DATA_PENDING)
+    {  // no data ready yet, poll the producer later
+        upload.pendingTimer =
+            _service->schedule(std::chrono::milliseconds(10), [this, response, transport](io_service&) {
+                response->_upload.pendingTimer.reset();
+                pumpRequestData(response, transport);
                 return true;
-                });
+            });
+        return;
+    }
+
+    if (n < 0 || (n == 0 && upload.bytesQueued < upload.size))
+    {
+        AXLOG("HttpClient: produce request data failed, %lld bytes sent", static_cast<long long>(upload.bytesQueued));
+        response->updateInternalCode(EIO);
+        _service->close(transport);
+        return;
+    }
+
+    if (n == 0)
+    {  // end of data
+        upload.producer = nullptr;
+        if (upload.chunked)
+        {
+            auto bytesTotal = upload.bytesQueued;
+            _service->forward(transport, "0\r\n\r\n", 5, [this, response, bytesTotal](int error, size_t) {
+                if (error == 0)
+                    reportUploadProgress(response, bytesTotal, bytesTotal);
+            });
         }
-        else
+        return;
+    }
+
+    // backpressure: only one chunk in flight, the next one is produced when it was written to the socket
+    chunk.resize((std::min)(n, chunkSize));
+    upload.bytesQueued += chunk.size();
+    response->_stats.bytesOut += chunk.size();
+    auto bytesSent  = upload.bytesQueued;
+    auto bytesTotal = upload.size;
+    auto onWritten  = [this, response, transport, bytesSent, bytesTotal](int error, size_t) {
+        if (error == 0)
         {
-            handleNetworkEOF(response, channel, event->status());
+            reportUploadProgress(response, bytesSent, bytesTotal);
+            pumpRequestData(response, transport);
         }
-        break;
-    case YEK_ON_CLOSE:
-        handleNetworkEOF(response, channel, event->status());
-        break;
+    };
+
+    if (upload.chunked)
+    {
+        char chunkHead[16];
+        auto result = std::to_chars(chunkHead, chunkHead + sizeof(chunkHead) - 2, chunk.size(), 16);
+        *result.ptr++ = '\r';
+        *result.ptr++ = '\n';
+
+        std::vector<io_send_buffer> buffers;
+        buffers.emplace_back(yasio::sbyte_buffer{chunkHead, result.ptr});
+        buffers.emplace_back(std::move(chunk));
+        buffers.emplace_back("\r\n", 2);
+        _service->writev(transport, std::move(buffers), std::move(onWritten));
     }
+    else
+        _service->write(transport, std::move(chunk), std::move(onWritten));
 }
 
+void HttpClient::reportUploadProgress(HttpResponse* response, int64_t bytesSent, int64_t bytesTotal)
+{
+    response->_lastActivityTime = yasio::clock();  // the written bytes keep the idle timeout away too
+
+    auto request = response->getHttpRequest();
+    if (!request->getUploadProgressCallback())
+        return;
+
+    // throttle the reports, but never drop the last one
+    auto& upload = response->_upload;
+    auto now     = yasio::clock();
+    if (bytesSent != bytesTotal && now - upload.lastProgressTime < UPLOAD_PROGRESS_INTERVAL)
+        return;
+    upload.lastProgressTime = now;
+
+    request->retain();
+    _scheduler->runOnAxmolThread([request, bytesSent, bytesTotal] {
+        auto& callback = request->getUploadProgressCallback();
+        if (callback)
+            callback(request, bytesSent, bytesTotal);
+        request->release();
+    });
+}
 
 void HttpClient::handleNetworkEOF(HttpResponse* response, yasio::io_channel* channel, int internalErrorCode)
 {
     channel->ud_.ptr = nullptr;
 
     channel->get_user_timer().cancel();
+    auto& upload = response->_upload;
+    if (upload.pendingTimer)
+    {
+        upload.pendingTimer->cancel();
+        upload.pendingTimer.reset();
+    }
+    upload.producer = nullptr;
+    if (response->_hedge.timer)
+    {
+        response->_hedge.timer->cancel();
+        response->_hedge.timer.reset();
+    }
     response->updateInternalCode(internalErrorCode);
+    if (settleHedge(response, false))
+    {  // the loser of a hedged pair, or it failed while the peer carries on
+        response->release();
+        recycleChannel(channel->index());
+        return;
+    }
     auto responseCode = response->getResponseCode();
     switch (responseCode)
     {
@@ -371,41 +1210,216 @@ void HttpClient::handleNetworkEOF(HttpResponse* response, yasio::io_channel* cha
             break;
         }
     default:
-        finishResponse(response);
+        if (!retryResponse(response))
+            finishResponse(response);
+        recycleChannel(channel->index());
+    }
+}
 
-        // try process pending response
-        auto lck = _pendingResponseQueue.get_lock();
-        if (!_pendingResponseQueue.unsafe_empty())
-        {
-            auto pendingResponse = _pendingResponseQueue.unsafe_front();
-            _pendingResponseQueue.unsafe_pop_front();
-            lck.unlock();
+void HttpClient::armHedge(HttpResponse* response, int channelIndex)
+{
+    // only the first attempt of a GET
+    auto request = response->getHttpRequest();
+    if (!request->isHedgingEnabled() || request->getRequestType() != HttpRequest::Type::GET ||
+        response->_hedge.hedged || response->getRedirectCount() != 0 || response->getAttemptCount() != 1)
+        return;
 
-            processResponse(pendingResponse, channel->index());
-            pendingResponse->release();
-        }
-        else
-        {  // recycle channel
-            _availChannelQueue.push_front(channel->index());
+    ++_hedgeCandidates;
+    int p95 = _latencyTracker->getPercentile(response->getRequestUri().getHost(), 95);
+    if (p95 < 0)
+        return;  // not enough samples of the host yet
+
+    response->_hedge.timer =
+        _service->schedule(std::chrono::milliseconds(p95), [this, response, channelIndex](io_service&) {
+            response->_hedge.timer.reset();
+            sendHedge(response, channelIndex);
+            return true;
+        });
+}
+
+void HttpClient::sendHedge(HttpResponse* response, int channelIndex)
+{
+    if (response->_headersComplete || response->_hedge.hedged)
+        return;
+
+    // cap the extra load, and never queue a hedge behind other requests
+    if ((_hedgesSent + 1) * 100 > static_cast<unsigned int>((std::max)(_hedgingBudget.load(), 0)) * _hedgeCandidates)
+        return;
+    int hedgeChannel = tryTakeAvailChannel();
+    if (hedgeChannel == -1)
+        return;
+
+    auto request = response->getHttpRequest();
+    auto hedge   = new HttpResponse(request);
+    hedge->setLocation(request->getUrl(), false);
+    hedge->_stats.createTime      = response->_stats.createTime;
+    hedge->_syncState             = response->_syncState;  // either of them may win
+    hedge->_completionHook        = response->_completionHook;
+    hedge->_completionHookContext = response->_completionHookContext;
+    hedge->_stats.queueRecorded   = true;
+
+    response->_hedge.hedged      = true;
+    response->_hedge.peer        = hedge;
+    response->_hedge.peerChannel = hedgeChannel;
+    hedge->_hedge.hedged         = true;
+    hedge->_hedge.isHedge        = true;
+    hedge->_hedge.peer           = response;
+    hedge->_hedge.peerChannel    = channelIndex;
+    ++_hedgesSent;
+
+    AXLOG("HttpClient: hedge %s on channel %d", request->getUrl().data(), hedgeChannel);
+    openChannel(hedge, hedgeChannel);  // the new response is owned by the channel
+}
+
+bool HttpClient::settleHedge(HttpResponse* response, bool won)
+{
+    auto peer = response->_hedge.peer;
+    if (!peer)
+        return response->_hedge.lost;
+
+    response->_hedge.peer = nullptr;
+    peer->_hedge.peer     = nullptr;
+    if (!won)
+    {
+        response->_hedge.lost = true;
+        return true;
+    }
+
+    // the loser is discarded when its channel closes, or as soon as it's connected
+    peer->_hedge.lost = true;
+    peer->updateInternalCode(yasio::errc::shutdown_by_localhost);
+    if (_service->is_open(response->_hedge.peerChannel))
+        _service->close(response->_hedge.peerChannel);
+    if (response->_hedge.isHedge)
+        ++_hedgesWon;
+    return false;
+}
+
+static int __classifyRetryError(int internalCode, int responseCode)
+{
+    using ErrorClass = HttpRequest::RetryPolicy::ErrorClass;
+    switch (internalCode)
+    {
+    case yasio::errc::resolve_host_failed:
+    case yasio::errc::no_available_address:
+    case yasio::errc::ssl_handshake_failed:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case EHOSTUNREACH:
+        return ErrorClass::CONNECT;
+    case ECONNRESET:
+    case ECONNABORTED:
+    case EPIPE:
+    case yasio::errc::ssl_read_failed:
+    case yasio::errc::ssl_write_failed:
+        return ErrorClass::RESET;
+    case yasio::errc::eof:  // closed by the server before the response was complete
+        return responseCode == -1 ? ErrorClass::RESET : 0;
+    case yasio::errc::read_timeout:
+    case ETIMEDOUT:
+        return ErrorClass::TIMEOUT;
+    }
+    return 0;
+}
+
+bool HttpClient::retryResponse(HttpResponse* response)
+{
+    auto request  = response->getHttpRequest();
+    auto& policy  = request->getRetryPolicy();
+    int attempt   = response->getAttemptCount();
+    if (attempt >= policy.maxAttempts || request->getRequestDataProducer())
+        return false;
+    if (request->getRequestType() == HttpRequest::Type::POST && !policy.idempotent)
+        return false;
+
+    int responseCode = response->getResponseCode();
+    if (responseCode != -1)
+    {
+        if (std::find(policy.statusCodes.begin(), policy.statusCodes.end(), responseCode) == policy.statusCodes.end())
+            return false;
+    }
+    else if (!(__classifyRetryError(response->getInternalCode(), responseCode) & policy.errorClasses))
+        return false;
+
+    // full jitter
+    static std::minstd_rand engine{std::random_device{}()};
+    long long backoff = (std::min)(static_cast<long long>(policy.backoffCap),
+                                   static_cast<long long>(policy.backoffBase) << (std::min)(attempt - 1, 20));
+    long long delay = std::uniform_int_distribution<long long>{0, (std::max)(backoff, 0LL)}(engine);
+
+    // only the delay-seconds form of Retry-After is honoured, an HTTP-date falls back to the backoff
+    auto& headers = response->getResponseHeaders();
+    auto it       = headers.find("retry-after");
+    if (it != headers.end())
+    {
+        long long seconds = 0;
+        auto& value       = it->second;
+        if (std::from_chars(value.data(), value.data() + value.size(), seconds).ec == std::errc{})
+        {
+            if (seconds * 1000 > policy.maxRetryAfter)
+                return false;
+            delay = (std::max)(delay, seconds * 1000);
         }
     }
+
+    AXLOG("HttpClient: retry %s in %lldms, attempt %d, code %d, ec=%d", request->getUrl().data(), delay, attempt + 1,
+          responseCode, response->getInternalCode());
+    response->prepareRetry();
+    _service->schedule(std::chrono::milliseconds(delay), [this, response](io_service&) {
+        processResponse(response, -1);
+        response->release();
+        return true;
+    });
+    return true;
 }
 
 void HttpClient::finishResponse(HttpResponse* response)
 {
     auto request   = response->getHttpRequest();
-    auto syncState = request->getSyncState();
+    auto syncState = response->_syncState;
+
+    auto& stats = response->_stats;
+    _metrics->recordRequest(response->getRequestUri().getHost(), response->getResponseCode(),
+                            response->getInternalCode(), stats.bytesIn, stats.bytesOut);
+    _metrics->recordLatency(HttpMetrics::Latency::TOTAL, yasio::highp_clock() - stats.createTime);
+
+    if (auto hook = response->_completionHook)
+    {
+        hook(response->_completionHookContext, response);
+        return;
+    }
 
     if (!syncState)
     {
+        auto workerPool = std::atomic_load(&_workerPool);
+        if (workerPool && workerPool->submit([this, response] {
+                if (_discardPoolCallbacks)
+                    response->release();
+                else
+                    invokeResposneCallbackAndRelease(response);
+            }))
+            return;
+
         if (_dispatchOnWorkThread || std::this_thread::get_id() == Director::getInstance()->getAxmolThreadId())
             invokeResposneCallbackAndRelease(response);
         else
-            _finishedResponseQueue.emplace_back(response);
+        {
+            // keep the queue ordered by priority, first in first out within a priority
+            auto priority = request->getPriority();
+            auto lck      = _finishedResponseQueue.get_lock();
+            auto it       = _finishedResponseQueue.unsafe_end();
+            while (it != _finishedResponseQueue.unsafe_begin() &&
+                   (*(it - 1))->getHttpRequest()->getPriority() < priority)
+                --it;
+            _finishedResponseQueue.unsafe_insert(it, response);
+        }
     }
     else
     {
-        syncState->set_value(response);
+        if (syncState->status.exchange(HttpResponse::SyncState::FINISHED) == HttpResponse::SyncState::ABANDONED)
+            response->release();
+        else
+            syncState->promise.set_value(response);
     }
 }
 
@@ -414,9 +1428,12 @@ void HttpClient::invokeResposneCallbackAndRelease(HttpResponse* response)
     HttpRequest* request                  = response->getHttpRequest();
     const ccHttpRequestCallback& callback = request->getCallback();
 
-    if (callback != nullptr)
+    if (auto handler = request->getResponseHandler())
+        handler(this, response);
+    else if (callback != nullptr)
         callback(this, response);
 
+    response->release();
 }
 
 void HttpClient::clearResponseQueue()
@@ -462,6 +1479,18 @@ int HttpClient::getTimeoutForRead()
     return _timeoutForRead;
 }
 
+void HttpClient::setTimeoutForTotal(int value)
+{
+    std::lock_guard<std::recursive_mutex> lock(_timeoutForTotalMutex);
+    _timeoutForTotal = value;
+}
+
+int HttpClient::getTimeoutForTotal()
+{
+    std::lock_guard<std::recursive_mutex> lock(_timeoutForTotalMutex);
+    return _timeoutForTotal;
+}
+
 std::string_view HttpClient::getCookieFilename()
 {
     std::lock_guard<std::recursive_mutex> lock(_cookieFileMutex);
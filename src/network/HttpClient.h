@@ -30,14 +30,19 @@
 #define __CCHTTPCLIENT_H__
 
 #include <thread>
+#include <atomic>
 #include <condition_variable>
 #include <deque>
+#include <unordered_map>
 #include "../base/Scheduler.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "HttpHeaderTemplate.h"
+#include "HttpMetrics.h"
 #include "Uri.h"
 #include "yasio_fwd.hpp"
 #include "../base/ConcurrentDeque.h"
+#include "../base/WorkerPool.h"
 
 /**
  * @addtogroup network
@@ -47,6 +52,20 @@
 namespace network
 {
 
+class DnsCache;
+class TlsSessionCache;
+class LatencyTracker;
+class HttpFetchAwaitable;
+
+/**
+ * The thread a coroutine awaiting HttpClient::fetch is resumed on.
+ */
+enum class HttpResumeOn
+{
+    GAME_THREAD,     /// by Scheduler::runOnAxmolThread, for UI work
+    NETWORK_THREAD,  /// right away on the network thread, such as to send a dependent request
+};
+
 /** Singleton that handles asynchronous http requests.
  *
  * Once the request completed, a callback will issued in main thread when it provided during make request.
@@ -61,6 +80,26 @@ public:
      */
     static const int MAX_CHANNELS       = 21;
 
+    /**
+     * The max bytes of a streamed request body produced at once.
+     */
+    static const int UPLOAD_CHUNK_SIZE  = 16 * 1024;
+
+    /**
+     * The min interval in milliseconds between two upload progress reports of a request.
+     */
+    static const int UPLOAD_PROGRESS_INTERVAL = 100;
+
+    /**
+     * How many seconds a preconnected connection waits for a request before it's closed.
+     */
+    static constexpr int WARM_CONNECTION_TIMEOUT = 10;
+
+    /**
+     * How many header sets acquireHeaderTemplate caches.
+     */
+    static const int MAX_HEADER_TEMPLATES = 16;
+
     /**
      * Get instance of HttpClient.
      *
@@ -87,6 +126,29 @@ public:
      */
     std::string_view getCookieFilename();
 
+    /**
+     * Enable persisting the warm-up state across launches: the resolved addresses with their TTLs,
+     * the address family that connected last and the TLS sessions per host.
+     * The snapshot is loaded now and its most used hosts are pre-resolved in the background,
+     * destroyInstance saves it again.
+     * The first preconnectCount of them are pre-connected instead, see preconnect, over https when
+     * a TLS session of the host was saved, over http otherwise.
+     * The TLS sessions hold resumption secrets in plain text, only the ones saved within
+     * TlsSessionCache::MAX_PERSISTED_AGE are written, keep the file in a directory private to the app.
+     *
+     * @param snapshotFile the filepath of snapshot file.
+     * @param preresolveCount how many of the most used hosts to pre-resolve.
+     * @param preconnectCount how many of the most used hosts to pre-connect, 0 to only pre-resolve.
+     */
+    void enableWarmupSnapshot(std::string_view snapshotFile, int preresolveCount = 4, int preconnectCount = 0);
+
+    /**
+     * Get the warm-up snapshot filename
+     *
+     * @return the warm-up snapshot filename, empty if not enabled.
+     */
+    std::string_view getWarmupSnapshotFilename();
+
     /**
      * Set root certificate path for SSL verification.
      *
@@ -116,6 +178,77 @@ public:
      */
     bool send(HttpRequest* request);
 
+    /**
+     * Tag to select the future-returning send overload.
+     */
+    struct UseFuture
+    {};
+    static constexpr UseFuture useFuture{};
+
+    /**
+     * Send http request concurrently, non-blocking, the response is delivered through the returned future
+     * from the network thread directly, so it can be waited on any thread without going through the game
+     * scheduler. The response callback of the request isn't invoked.
+     *
+     * @param request a HttpRequest object.
+     * @return the future of the response, the caller must release the response got from it.
+     */
+    std::future<HttpResponse*> send(HttpRequest* request, UseFuture);
+
+    /**
+     * Send http request and block the caller thread until the response is finished.
+     * Don't call it on the game thread unless the timeout is short.
+     *
+     * @param request a HttpRequest object.
+     * @param timeoutMs the max milliseconds to wait, -1 to wait forever.
+     * @return the response, the caller must release it, or nullptr if timeout, the abandoned response is
+     *         released by HttpClient when it's finished.
+     */
+    HttpResponse* sendSync(HttpRequest* request, int timeoutMs = -1);
+
+    /**
+     * Send many requests at once, such as a burst of thumbnails: the free channels are taken with one lock
+     * and opened with a single wakeup of the network thread, the rest wait in the pending queue together.
+     *
+     * @param requests the requests, nullptr items are skipped.
+     * @param count the count of requests.
+     * @return the count of requests sent.
+     */
+    int sendBatch(HttpRequest* const* requests, size_t count);
+
+    int sendBatch(const std::vector<HttpRequest*>& requests) { return sendBatch(requests.data(), requests.size()); }
+
+    /**
+     * Send the request and call the hook with the finished response instead of the response callback.
+     * The hook belongs to this send only, the request can be sent again meanwhile, such as by another fetch.
+     *
+     * @param hook called on the network thread, it takes over the reference of the response.
+     * @param context passed to the hook.
+     */
+    void sendWithCompletionHook(HttpRequest* request, HttpResponse::CompletionHook hook, void* context);
+
+    /**
+     * Send the request from a C++20 coroutine, `auto response = co_await client->fetch(request);`
+     * It's declared here, include HttpAwaitable.h to use it, it needs C++20, see CONCURRENTHTTP_COROUTINES
+     * and tests/fetch_awaitable.
+     *
+     * @param resumeOn the thread to resume the coroutine on.
+     */
+    HttpFetchAwaitable fetch(HttpRequest* request, HttpResumeOn resumeOn = HttpResumeOn::GAME_THREAD);
+
+    /**
+     * Open connections to the host of the url ahead of the requests, the TCP and TLS handshakes
+     * are done on idle channels and the connections are parked in a warm pool, the next requests
+     * to the same host take them and are sent immediately.
+     * Unused warm connections are closed after WARM_CONNECTION_TIMEOUT, or as soon as a request
+     * to another host needs the channel.
+     *
+     * @param url any url of the host, only the scheme, host and port are used.
+     * @param count how many connections to open, limited by the idle channels.
+     * @return the number of connections being opened.
+     */
+    int preconnect(std::string_view url, int count = 1);
+
     /**
      * Set the timeout value for connecting.
      *
@@ -131,9 +264,11 @@ public:
     int getTimeoutForConnect();
 
     /**
-     * Set the timeout value for reading.
+     * Set the timeout value for reading, it's an idle timeout: the request fails when no byte was received or
+     * written for so many seconds, a slow but healthy download is never interrupted.
+     * HttpRequest::setTimeoutForIdle overrides it per request.
      *
-     * @param value the timeout value for reading.
+     * @param value the timeout value for reading in seconds, 0 to disable.
      */
     void setTimeoutForRead(int value);
 
@@ -144,6 +279,21 @@ public:
      */
     int getTimeoutForRead();
 
+    /**
+     * Set the max seconds a request may take from being sent until the response is complete.
+     * HttpRequest::setTimeoutForTotal overrides it per request.
+     *
+     * @param value the total timeout in seconds, 0 (the default) for no limit.
+     */
+    void setTimeoutForTotal(int value);
+
+    /**
+     * Get the total timeout value.
+     *
+     * @return int the total timeout in seconds.
+     */
+    int getTimeoutForTotal();
+
     std::recursive_mutex& getCookieFileMutex() { return _cookieFileMutex; }
 
     std::recursive_mutex& getSSLCaFileMutex() { return _sslCaFileMutex; }
@@ -176,6 +326,55 @@ public:
     void setDispatchOnWorkThread(bool bVal);
     bool isDispatchOnWorkThread() const { return _dispatchOnWorkThread; }
 
+    /**
+     * Dispatch the response callbacks on a pool of worker threads, so a slow callback blocks neither the
+     * network thread nor the game thread. Use Scheduler::runOnAxmolThread in the callback for UI work.
+     * When the pool is full the callback is dispatched on the game thread instead.
+     * It replaces setDispatchOnWorkThread, which stops the pool again. Called from a callback on the pool,
+     * the old pool is stopped on the game thread.
+     *
+     * @param threadCount the worker threads, 0 to stop the pool and dispatch on the game thread.
+     * @param maxQueued the max callbacks queued to the pool.
+     */
+    void setDispatchOnWorkerPool(int threadCount, int maxQueued = 256);
+
+    /**
+     * Get the worker pool of the callbacks, such as to read its queue depth, nullptr if not enabled.
+     */
+    std::shared_ptr<WorkerPool> getWorkerPool() const { return std::atomic_load(&_workerPool); }
+
+    /**
+     * The cost of the response callbacks dispatched on the game thread, see setDispatchTimeBudget.
+     */
+    struct DispatchStats
+    {
+        unsigned int frames     = 0;  /// the frames which dispatched any callback
+        unsigned int callbacks  = 0;  /// the callbacks dispatched
+        unsigned int overBudget = 0;  /// the frames which exceeded the budget
+        float totalTime         = 0;  /// milliseconds spent in the callbacks
+        float lastFrameTime     = 0;  /// milliseconds spent in the callbacks of the last dispatching frame
+        float maxFrameTime      = 0;  /// the max milliseconds spent in the callbacks of a frame
+        float maxCallbackTime   = 0;  /// the max milliseconds spent in a callback
+        unsigned int backlog    = 0;  /// the responses left for the next frames after the last dispatching frame
+    };
+
+    /**
+     * Set the max milliseconds spent in the response callbacks per frame, the rest are dispatched on the next
+     * frames, the callbacks of higher HttpRequest::getPriority first. A frame always dispatches one at least.
+     *
+     * @param milliseconds the budget, 4 by default, 0 to dispatch one callback per frame.
+     */
+    void setDispatchTimeBudget(float milliseconds) { _dispatchTimeBudget = milliseconds; }
+
+    float getDispatchTimeBudget() const { return _dispatchTimeBudget; }
+
+    /**
+     * Get the frame time impact of the response callbacks, call it on the game thread.
+     */
+    const DispatchStats& getDispatchStats() const { return _dispatchStats; }
+
+    void resetDispatchStats() { _dispatchStats = DispatchStats{}; }
+
     /*
      * When the device network status chagned, you should invoke this function
      */
@@ -187,6 +386,85 @@ public:
      */
     void setNameServers(std::string_view servers);
 
+    /**
+     * Get the name resolution cache shared by all channels.
+     */
+    DnsCache* getDnsCache() const { return _dnsCache; }
+
+    /**
+     * Get the TLS session cache shared by all channels, it also reports the resumption hit rate.
+     */
+    TlsSessionCache* getTlsSessionCache() const { return _tlsSessionCache; }
+
+    /**
+     * Get the time to response headers tracked per host.
+     */
+    LatencyTracker* getLatencyTracker() const { return _latencyTracker; }
+
+    /**
+     * Get the request counters and latency histograms.
+     */
+    HttpMetrics* getMetrics() const { return _metrics; }
+
+    /**
+     * Sum up the metrics of all threads and sample the channel and queue gauges.
+     */
+    HttpMetrics::Snapshot getMetricsSnapshot();
+
+    /**
+     * Write a metrics snapshot as JSON to the file.
+     *
+     * @return true if written.
+     */
+    bool dumpMetrics(std::string_view path);
+
+    /**
+     * Set the max extra load of hedging, see HttpRequest::setHedging.
+     *
+     * @param percent the max hedges sent per 100 hedging requests, 10 by default, 0 to disable hedging.
+     */
+    void setHedgingBudget(int percent) { _hedgingBudget = percent; }
+
+    int getHedgingBudget() const { return _hedgingBudget; }
+
+    /**
+     * Get the number of hedges sent, and how many of them won.
+     */
+    unsigned int getHedgeCount() const { return _hedgesSent; }
+    unsigned int getHedgeWinCount() const { return _hedgesWon; }
+
+    /**
+     * Register a fixed header block, serialized once and shared by every request using it.
+     * Registering an existing name replaces the template, requests already holding it are not affected.
+     *
+     * @param name the name to lookup the template later.
+     * @param headers the custom headers, such as "Content-Type: application/json".
+     * @return the template, pass it to HttpRequest::setHeaderTemplate.
+     */
+    HttpHeaderTemplatePtr registerHeaderTemplate(std::string_view name, const std::vector<std::string>& headers);
+
+    /**
+     * Get a header template registered by registerHeaderTemplate.
+     *
+     * @return the template, or nullptr if no template registered with the name.
+     */
+    HttpHeaderTemplatePtr getHeaderTemplate(std::string_view name);
+
+    /**
+     * Remove a header template registered by registerHeaderTemplate.
+     */
+    void unregisterHeaderTemplate(std::string_view name);
+
+    /**
+     * Get the template of a header set, created on first use and cached by the hash of the headers,
+     * so requests with different header sets don't replace each other's template.
+     * At most MAX_HEADER_TEMPLATES are cached, requests already holding a template are not affected.
+     *
+     * @param headers the custom headers, such as "Content-Type: application/json".
+     * @return the template, pass it to HttpRequest::setHeaderTemplate.
+     */
+    HttpHeaderTemplatePtr acquireHeaderTemplate(const std::vector<std::string>& headers);
+
     yasio::io_service* getInternalService();
 
     HttpClient();
@@ -194,10 +472,67 @@ public:
 
     void processResponse(HttpResponse* response, int channelIndex);
 
+    /**
+     * Create the response of a new send, it's returned with one reference owned by the caller.
+     */
+    HttpResponse* createResponse(HttpRequest* request);
+
+    std::future<HttpResponse*> sendWithFuture(HttpRequest* request, std::shared_ptr<HttpResponse::SyncState> syncState);
+
+    void openChannel(HttpResponse* response, int channelIndex);
+
+    /**
+     * Bind the response to the channel and set its remote endpoint.
+     *
+     * @return the channel kind to open it with.
+     */
+    int prepareChannel(HttpResponse* response, int channelIndex);
+
+    /**
+     * Record the wait of the response for its first channel.
+     *
+     * @param opening whether the channel connects, the connect time is recorded once it's open.
+     */
+    void recordChannelTaken(HttpResponse* response, bool opening);
+
     int tryTakeAvailChannel();
 
+    void recycleChannel(int channelIndex);
+
+    bool tryTakeWarmChannel(HttpResponse* response);
+
+    void evictWarmChannel();
+
+    void handleWarmChannelEvent(yasio::io_event* event);
+
+    void startRequest(HttpResponse* response, yasio::io_channel* channel, yasio::transport_handle_t transport);
+
+    /**
+     * Send the failed response again later if its request's retry policy allows.
+     *
+     * @return true if the retry was scheduled, it takes over the reference of the channel.
+     */
+    bool retryResponse(HttpResponse* response);
+
+    void armHedge(HttpResponse* response, int channelIndex);
+
+    void sendHedge(HttpResponse* response, int channelIndex);
+
+    /**
+     * Settle a hedged pair when one of them got the headers or failed.
+     *
+     * @return true if the response lost and must be discarded.
+     */
+    bool settleHedge(HttpResponse* response, bool won);
+
     void handleNetworkEvent(yasio::io_event* event);
 
+    void sendRequest(HttpResponse* response, yasio::transport_handle_t transport);
+
+    void pumpRequestData(HttpResponse* response, yasio::transport_handle_t transport);
+
+    void reportUploadProgress(HttpResponse* response, int64_t bytesSent, int64_t bytesTotal);
+
     void handleNetworkEOF(HttpResponse* response, yasio::io_channel* channel, int internalErrorCode);
 
     void tickInput();
@@ -205,6 +540,10 @@ public:
     void finishResponse(HttpResponse* response);
 
     void invokeResposneCallbackAndRelease(HttpResponse* response);
+    void releaseWorkerPool(std::shared_ptr<WorkerPool> workerPool);
+
+    void loadWarmupSnapshot(int preresolveCount, int preconnectCount);
+    void saveWarmupSnapshot();
 
 
 private:
@@ -212,14 +551,34 @@ private:
 
     yasio::io_service* _service;
 
+    DnsCache* _dnsCache;
+
+    TlsSessionCache* _tlsSessionCache;
+
+    LatencyTracker* _latencyTracker;
+    HttpMetrics* _metrics;
+    std::atomic<int> _hedgingBudget;
+    unsigned int _hedgeCandidates;  // these are modified on the network thread only
+    std::atomic<unsigned int> _hedgesSent;
+    std::atomic<unsigned int> _hedgesWon;
+
     bool _dispatchOnWorkThread;
 
+    std::shared_ptr<WorkerPool> _workerPool;
+    std::atomic<bool> _discardPoolCallbacks;  // set while destroying, the queued callbacks only release their response
+
+    float _dispatchTimeBudget;
+    DispatchStats _dispatchStats;
+
     int _timeoutForConnect;
     std::recursive_mutex _timeoutForConnectMutex;
 
     int _timeoutForRead;
     std::recursive_mutex _timeoutForReadMutex;
 
+    int _timeoutForTotal;
+    std::recursive_mutex _timeoutForTotalMutex;
+
     Scheduler* _scheduler;
 
     ConcurrentDeque<HttpResponse*> _pendingResponseQueue;
@@ -230,10 +589,27 @@ private:
     std::string _cookieFilename;
     std::recursive_mutex _cookieFileMutex;
 
+    std::string _warmupSnapshotFilename;
+    std::recursive_mutex _warmupSnapshotMutex;
+
     std::string _sslCaFilename;
     std::recursive_mutex _sslCaFileMutex;
 
     ClearResponsePredicate _clearResponsePredicate;
+
+    std::unordered_map<std::string, HttpHeaderTemplatePtr> _headerTemplates;
+    std::unordered_map<uint64_t, HttpHeaderTemplatePtr> _headerTemplatesByHash;
+    std::recursive_mutex _headerTemplatesMutex;
+
+    struct WarmChannel
+    {
+        std::string host;
+        int port;
+        bool secure;
+        yasio::transport_handle_t transport;  // nullptr while connecting or closing
+    };
+    std::unordered_map<int, WarmChannel> _warmChannels;  // by channel index
+    std::recursive_mutex _warmChannelsMutex;
 };
 
 }  // namespace network
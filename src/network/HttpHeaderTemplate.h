@@ -0,0 +1,161 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef __HTTP_HEADER_TEMPLATE_H__
+#define __HTTP_HEADER_TEMPLATE_H__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include "string_view.hpp"
+
+/**
+ * @addtogroup network
+ * @{
+ */
+
+namespace network
+{
+
+/**
+ * A fixed block of request headers serialized once, so HttpClient only has to splice
+ * the request line, Host and Content-Length around it for every request that uses it.
+ *
+ * Create it with HttpClient::registerHeaderTemplate and attach it with HttpRequest::setHeaderTemplate.
+ *
+ * @lua NA
+ */
+class HttpHeaderTemplate
+{
+public:
+    struct HeaderFlag
+    {
+        enum
+        {
+            USER_AGENT   = 1,
+            CONTENT_TYPE = 1 << 1,
+            ACCEPT       = 1 << 2,
+        };
+    };
+
+    /**
+     * Serializes the headers, the default User-Agent and Accept are appended when absent.
+     *
+     * @param headers the custom headers, such as "Content-Type: application/json".
+     */
+    explicit HttpHeaderTemplate(const std::vector<std::string>& headers)
+        : _headers(headers), _hash(hashHeaders(headers)), _flags(0)
+    {
+        for (auto&& header : _headers)
+        {
+            _bytes.append(header);
+            _bytes.append("\r\n");
+            _flags |= scanHeaderFlag(header);
+        }
+
+        if (!(_flags & HeaderFlag::USER_AGENT))
+            _bytes.append("User-Agent: \r\n");
+
+        if (!(_flags & HeaderFlag::ACCEPT))
+            _bytes.append("Accept: */*;q=0.8\r\n");
+
+        _flags |= HeaderFlag::USER_AGENT | HeaderFlag::ACCEPT;
+    }
+
+    /**
+     * Get the pre-serialized header block, every header is terminated with CRLF.
+     */
+    std::string_view getBytes() const { return _bytes; }
+
+    /**
+     * Get the HeaderFlag bits of the headers the block already contains.
+     */
+    int getFlags() const { return _flags; }
+
+    /**
+     * Get the headers the template was created from.
+     */
+    const std::vector<std::string>& getHeaders() const { return _headers; }
+
+    /**
+     * Get the hash of the headers the template was created from, see hashHeaders.
+     */
+    uint64_t getHash() const { return _hash; }
+
+    /**
+     * Hash a header set with 64-bit FNV-1a, the order of the headers matters.
+     * Different sets may collide, such as headers holding the separator, check a hit with matches.
+     */
+    static uint64_t hashHeaders(const std::vector<std::string>& headers)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (auto&& header : headers)
+        {
+            for (auto ch : header)
+                hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ULL;
+            hash = (hash ^ '\n') * 1099511628211ULL;  // so {"ab"} and {"a", "b"} differ
+        }
+        return hash;
+    }
+
+    /**
+     * Check whether the template was created from exactly these headers.
+     */
+    bool matches(const std::vector<std::string>& headers) const { return _headers == headers; }
+
+    /**
+     * Classify a single "Name: value" header line.
+     *
+     * @return the HeaderFlag bit of the header, or 0 if HttpClient doesn't care about it.
+     */
+    static int scanHeaderFlag(std::string_view header)
+    {
+        using namespace cxx17;  // for string_view literal
+        cxx17::string_view value{header.data(), header.size()};
+        if (cxx20::ic::starts_with(value, "User-Agent:"_sv))
+            return HeaderFlag::USER_AGENT;
+        if (cxx20::ic::starts_with(value, "Content-Type:"_sv))
+            return HeaderFlag::CONTENT_TYPE;
+        if (cxx20::ic::starts_with(value, "Accept:"_sv))
+            return HeaderFlag::ACCEPT;
+        return 0;
+    }
+
+private:
+    std::vector<std::string> _headers;
+    uint64_t _hash;
+    std::string _bytes;
+    int _flags;
+};
+
+typedef std::shared_ptr<const HttpHeaderTemplate> HttpHeaderTemplatePtr;
+
+}  // namespace network
+
+// end group
+/// @}
+
+#endif  //__HTTP_HEADER_TEMPLATE_H__
@@ -0,0 +1,295 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#include "HttpMetrics.h"
+#include <algorithm>
+#include <fstream>
+
+namespace network
+{
+
+static std::atomic<unsigned int> s_nextMetricsId{1};
+
+static const char* s_latencyNames[] = {"queueWait", "connect", "ttfb", "total"};
+
+static void appendJsonString(std::string& json, std::string_view value)
+{
+    json.push_back('"');
+    for (auto ch : value)
+    {
+        if (ch == '"' || ch == '\\')
+            json.push_back('\\');
+        if (static_cast<unsigned char>(ch) >= 0x20)
+            json.push_back(ch);
+    }
+    json.push_back('"');
+}
+
+template <typename _Ty>
+static void appendJsonField(std::string& json, const char* name, _Ty value, bool last = false)
+{
+    json.push_back('"');
+    json.append(name);
+    json.append("\":");
+    json.append(std::to_string(value));
+    if (!last)
+        json.push_back(',');
+}
+
+uint64_t HttpMetrics::Histogram::getPercentile(double percentile) const
+{
+    if (count == 0)
+        return 0;
+
+    auto rank = static_cast<uint64_t>(count * percentile / 100.0 + 0.5);
+    rank      = (std::max)(rank, static_cast<uint64_t>(1));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return (std::min)(getBucketValue(static_cast<int>(i)), max);
+    }
+    return max;
+}
+
+std::string HttpMetrics::Snapshot::toJson() const
+{
+    std::string json = "{";
+
+    json.append("\"channels\":{");
+    appendJsonField(json, "total", channels);
+    appendJsonField(json, "inUse", channelsInUse);
+    appendJsonField(json, "warm", warmChannels, true);
+    json.append("},");
+    appendJsonField(json, "pendingRequests", pendingRequests);
+    appendJsonField(json, "finishedBacklog", finishedBacklog);
+
+    json.append("\"hosts\":{");
+    for (auto it = hosts.begin(); it != hosts.end(); ++it)
+    {
+        if (it != hosts.begin())
+            json.push_back(',');
+        appendJsonString(json, it->first);
+        json.append(":{");
+        appendJsonField(json, "requests", it->second.requests);
+        appendJsonField(json, "bytesIn", it->second.bytesIn);
+        appendJsonField(json, "bytesOut", it->second.bytesOut, true);
+        json.push_back('}');
+    }
+    json.append("},");
+
+    auto appendCodes = [&json](const char* name, const std::map<int, uint64_t>& codes) {
+        json.push_back('"');
+        json.append(name);
+        json.append("\":{");
+        for (auto it = codes.begin(); it != codes.end(); ++it)
+        {
+            if (it != codes.begin())
+                json.push_back(',');
+            auto code = std::to_string(it->first);
+            appendJsonField(json, code.c_str(), it->second, true);
+        }
+        json.append("},");
+    };
+    appendCodes("statusCodes", statusCodes);
+    appendCodes("errors", errors);
+
+    // microseconds
+    json.append("\"latencies\":{");
+    for (int i = 0; i < static_cast<int>(Latency::COUNT); ++i)
+    {
+        auto& histogram = latencies[i];
+        if (i > 0)
+            json.push_back(',');
+        appendJsonString(json, s_latencyNames[i]);
+        json.append(":{");
+        appendJsonField(json, "count", histogram.count);
+        appendJsonField(json, "mean", histogram.getMean());
+        appendJsonField(json, "p50", histogram.getPercentile(50));
+        appendJsonField(json, "p90", histogram.getPercentile(90));
+        appendJsonField(json, "p99", histogram.getPercentile(99));
+        appendJsonField(json, "p999", histogram.getPercentile(99.9));
+        appendJsonField(json, "max", histogram.max, true);
+        json.push_back('}');
+    }
+    json.append("}}");
+    return json;
+}
+
+bool HttpMetrics::Snapshot::writeJson(std::string_view path) const
+{
+    std::ofstream file(std::string{path}, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+    auto json = toJson();
+    file.write(json.data(), json.size());
+    return file.good();
+}
+
+HttpMetrics::HttpMetrics() : _id(s_nextMetricsId++) {}
+
+HttpMetrics::~HttpMetrics() {}
+
+int HttpMetrics::getBucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return static_cast<int>(value);
+
+    int exponent = 63;
+    while (!(value >> exponent))
+        --exponent;
+    if (exponent > MAX_EXPONENT)
+        return BUCKET_COUNT - 1;
+
+    int group = exponent - SUB_BUCKET_BITS + 1;
+    int sub   = static_cast<int>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return group * SUB_BUCKETS + sub;
+}
+
+uint64_t HttpMetrics::getBucketValue(int index)
+{
+    int group = index / SUB_BUCKETS;
+    int sub   = index % SUB_BUCKETS;
+    if (group == 0)
+        return sub;
+
+    int shift = group - 1;
+    return ((static_cast<uint64_t>(SUB_BUCKETS + sub) + 1) << shift) - 1;
+}
+
+HttpMetrics::Shard* HttpMetrics::getLocalShard()
+{
+    static thread_local unsigned int cachedId = 0;
+    static thread_local Shard* cachedShard    = nullptr;
+    if (cachedId == _id)
+        return cachedShard;
+
+    auto owner = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lck(_shardsMutex);
+    auto it = std::find_if(_shards.begin(), _shards.end(), [owner](auto& shard) { return shard->owner == owner; });
+    if (it == _shards.end())
+    {
+        _shards.emplace_back(new Shard());
+        _shards.back()->owner = owner;
+        it = _shards.end() - 1;
+    }
+    cachedId    = _id;
+    cachedShard = it->get();
+    return cachedShard;
+}
+
+void HttpMetrics::recordRequest(std::string_view host,
+                                int statusCode,
+                                int internalCode,
+                                uint64_t bytesIn,
+                                uint64_t bytesOut)
+{
+    auto shard = getLocalShard();
+
+    auto hostCounters = shard->lastHostCounters;
+    if (!hostCounters || shard->lastHost != host)
+    {
+        auto it = shard->hosts.find(std::string{host});
+        if (it == shard->hosts.end())
+        {
+            std::lock_guard<std::mutex> lck(shard->mutex);
+            it = shard->hosts.try_emplace(std::string{host}).first;
+        }
+        hostCounters            = &it->second;
+        shard->lastHost         = host;
+        shard->lastHostCounters = hostCounters;
+    }
+    add(hostCounters->requests, 1);
+    add(hostCounters->bytesIn, bytesIn);
+    add(hostCounters->bytesOut, bytesOut);
+
+    auto status = shard->statusCodes.find(statusCode);
+    if (status == shard->statusCodes.end())
+    {
+        std::lock_guard<std::mutex> lck(shard->mutex);
+        status = shard->statusCodes.try_emplace(statusCode).first;
+    }
+    add(status->second, 1);
+
+    if (statusCode <= 0 && internalCode != 0)
+    {
+        auto error = shard->errors.find(internalCode);
+        if (error == shard->errors.end())
+        {
+            std::lock_guard<std::mutex> lck(shard->mutex);
+            error = shard->errors.try_emplace(internalCode).first;
+        }
+        add(error->second, 1);
+    }
+}
+
+void HttpMetrics::recordLatency(Latency latency, int64_t microseconds)
+{
+    auto value      = static_cast<uint64_t>((std::max)(microseconds, static_cast<int64_t>(0)));
+    auto& histogram = getLocalShard()->latencies[static_cast<int>(latency)];
+    add(histogram.count, 1);
+    add(histogram.sum, value);
+    add(histogram.buckets[getBucketIndex(value)], 1);
+    if (value > histogram.max.value.load(std::memory_order_relaxed))
+        histogram.max.value.store(value, std::memory_order_relaxed);
+}
+
+HttpMetrics::Snapshot HttpMetrics::snapshot() const
+{
+    Snapshot snapshot;
+    for (auto& histogram : snapshot.latencies)
+        histogram.buckets.resize(BUCKET_COUNT);
+
+    std::lock_guard<std::mutex> lck(_shardsMutex);
+    for (auto& shard : _shards)
+    {
+        std::lock_guard<std::mutex> shardLock(shard->mutex);
+        for (auto& host : shard->hosts)
+        {
+            auto& stats = snapshot.hosts[host.first];
+            stats.requests += host.second.requests.value.load(std::memory_order_relaxed);
+            stats.bytesIn += host.second.bytesIn.value.load(std::memory_order_relaxed);
+            stats.bytesOut += host.second.bytesOut.value.load(std::memory_order_relaxed);
+        }
+        for (auto& status : shard->statusCodes)
+            snapshot.statusCodes[status.first] += status.second.value.load(std::memory_order_relaxed);
+        for (auto& error : shard->errors)
+            snapshot.errors[error.first] += error.second.value.load(std::memory_order_relaxed);
+
+        for (int i = 0; i < static_cast<int>(Latency::COUNT); ++i)
+        {
+            auto& counters  = shard->latencies[i];
+            auto& histogram = snapshot.latencies[i];
+            histogram.count += counters.count.value.load(std::memory_order_relaxed);
+            histogram.sum += counters.sum.value.load(std::memory_order_relaxed);
+            histogram.max = (std::max)(histogram.max, counters.max.value.load(std::memory_order_relaxed));
+            for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+                histogram.buckets[bucket] += counters.buckets[bucket].value.load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+}  // namespace network
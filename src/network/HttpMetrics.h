@@ -0,0 +1,213 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef __HTTP_METRICS_H__
+#define __HTTP_METRICS_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @addtogroup network
+ * @{
+ */
+
+namespace network
+{
+
+/**
+ * The request counters and latency histograms of HttpClient.
+ *
+ * Every thread records into its own shard without locks, the shards are summed up when a snapshot
+ * is taken, so recording stays cheap on the network thread.
+ *
+ * @lua NA
+ */
+class HttpMetrics
+{
+public:
+    enum class Latency
+    {
+        QUEUE_WAIT,  /// from send to the channel opened
+        CONNECT,     /// from the channel opened to connected, warm channels aren't counted
+        TTFB,        /// from the request sent to the first byte of the response
+        TOTAL,       /// from send to the response finished
+        COUNT
+    };
+
+    /**
+     * Every power of 2 is split into SUB_BUCKETS linear buckets like a HDR histogram,
+     * so a recorded value is off by less than 1/SUB_BUCKETS, from 1 microsecond to hours.
+     */
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS     = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT    = 36;  // about 19 hours in microseconds
+    static constexpr int BUCKET_COUNT    = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    struct HostStats
+    {
+        uint64_t requests = 0;
+        uint64_t bytesIn  = 0;  /// the bytes received, headers included
+        uint64_t bytesOut = 0;  /// the bytes of the requests written
+    };
+
+    struct Histogram
+    {
+        uint64_t count = 0;
+        uint64_t sum   = 0;  /// microseconds
+        uint64_t max   = 0;  /// microseconds
+        std::vector<uint64_t> buckets;
+
+        /**
+         * Get the latency percentile.
+         *
+         * @param percentile in (0, 100], such as 99.9.
+         * @return the highest value in the bucket of the percentile in microseconds, 0 if nothing was recorded.
+         */
+        uint64_t getPercentile(double percentile) const;
+
+        uint64_t getMean() const { return count ? sum / count : 0; }
+    };
+
+    /**
+     * The metrics summed up at a moment, the counters are totals since the HttpClient was created.
+     */
+    struct Snapshot
+    {
+        std::map<std::string, HostStats> hosts;
+        std::map<int, uint64_t> statusCodes;  /// -1 for the requests without a response
+        std::map<int, uint64_t> errors;       /// yasio error codes of the requests failed without a response
+        Histogram latencies[static_cast<int>(Latency::COUNT)];
+
+        // the gauges at the moment, filled by HttpClient::getMetricsSnapshot
+        int channels        = 0;
+        int channelsInUse   = 0;  /// busy or kept warm
+        int warmChannels    = 0;
+        int pendingRequests = 0;  /// waiting for a free channel
+        int finishedBacklog = 0;  /// waiting for the response callback
+
+        const Histogram& getLatency(Latency latency) const { return latencies[static_cast<int>(latency)]; }
+
+        std::string toJson() const;
+
+        /**
+         * Write the snapshot as JSON to the file, such as to tune the channels and timeouts offline.
+         *
+         * @return true if written.
+         */
+        bool writeJson(std::string_view path) const;
+    };
+
+    HttpMetrics();
+    ~HttpMetrics();
+
+    /**
+     * Count a finished request.
+     *
+     * @param internalCode the yasio error code, only counted if there's no response.
+     */
+    void recordRequest(std::string_view host, int statusCode, int internalCode, uint64_t bytesIn, uint64_t bytesOut);
+
+    /**
+     * Add a latency sample in microseconds.
+     */
+    void recordLatency(Latency latency, int64_t microseconds);
+
+    /**
+     * Sum up the shards of all threads, the gauges are left empty.
+     */
+    Snapshot snapshot() const;
+
+    static int getBucketIndex(uint64_t value);
+
+    /**
+     * The highest value which falls into the bucket.
+     */
+    static uint64_t getBucketValue(int index);
+
+private:
+    struct Counter
+    {
+        std::atomic<uint64_t> value{0};
+    };
+
+    struct HostCounters
+    {
+        Counter requests;
+        Counter bytesIn;
+        Counter bytesOut;
+    };
+
+    struct HistogramCounters
+    {
+        Counter count;
+        Counter sum;
+        Counter max;
+        Counter buckets[BUCKET_COUNT];
+    };
+
+    /**
+     * The counters of one thread, only the owner thread writes them. New keys are inserted by the owner
+     * under the mutex, which the snapshot holds while reading, the values are atomics read without it.
+     */
+    struct Shard
+    {
+        std::thread::id owner;
+        std::mutex mutex;
+        std::unordered_map<std::string, HostCounters> hosts;
+        std::unordered_map<int, Counter> statusCodes;
+        std::unordered_map<int, Counter> errors;
+        HistogramCounters latencies[static_cast<int>(Latency::COUNT)];
+
+        std::string lastHost;  // most requests go to the same host, skip the lookup
+        HostCounters* lastHostCounters = nullptr;
+    };
+
+    Shard* getLocalShard();
+
+    // only the owner thread writes, so a plain load and store is enough
+    static void add(Counter& counter, uint64_t value)
+    {
+        counter.value.store(counter.value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    unsigned int _id;  // tells the thread local shard cache which instance it belongs to
+    mutable std::mutex _shardsMutex;
+    std::vector<std::unique_ptr<Shard>> _shards;
+};
+
+}  // namespace network
+
+// end group
+/// @}
+
+#endif  //__HTTP_METRICS_H__
@@ -34,10 +34,12 @@
 #include <vector>
 #include <memory>
 #include <future>
+#include <atomic>
 #include "../base/Ref.h"
 #include "../base/Macros.h"
 
 #include "byte_buffer.hpp"
+#include "HttpHeaderTemplate.h"
 #include "../base/CArray.h"
 #include "ExtensionMacros.h"
 
@@ -50,10 +52,32 @@ namespace network
 {
 
 class HttpClient;
+class HttpRequest;
 class HttpResponse;
 
 typedef std::function<void(HttpClient* client, HttpResponse* response)> ccHttpRequestCallback;
 
+/**
+ * The pull callback of a streamed request body, it's invoked on the network thread each time the
+ * previous chunk was written to the socket.
+ *
+ * @return > 0 the bytes written to buffer, 0 at the end of data,
+ *         HttpRequest::REQUEST_DATA_PENDING if no data is ready yet, other negative values abort the request.
+ */
+typedef std::function<int(char* buffer, int size)> ccHttpRequestDataProducer;
+
+/**
+ * A plain function invoked instead of the response callback, for bridges which find their state
+ * through the request and don't want a type-erased callback per request.
+ */
+typedef void (*ccHttpResponseHandler)(HttpClient* client, HttpResponse* response);
+
+/**
+ * The upload progress callback, invoked on the game thread.
+ * bytesTotal is -1 until the end of data if the size of a streamed request body is unknown.
+ */
+typedef std::function<void(HttpRequest* request, int64_t bytesSent, int64_t bytesTotal)> ccHttpUploadProgressCallback;
+
 /**
  * Defines the object which users must packed for HttpClient::send(HttpRequest*) method.
  * Please refer to tests/test-cpp/Classes/ExtensionTest/NetworkTest/HttpClientTest.cpp as a sample
@@ -65,10 +89,16 @@ typedef std::function<void(HttpClient* client, HttpResponse* response)> ccHttpRe
 class HttpRequest : public Ref
 {
     friend class HttpClient;
+    friend class HttpFetchAwaitable;
 
 public:
     static const int MAX_REDIRECT_COUNT = 3;
 
+    /**
+     * Returned by a ccHttpRequestDataProducer when no data is ready yet, it will be polled again later.
+     */
+    static const int REQUEST_DATA_PENDING = -2;
+
     /**
      * The HttpRequest type enum used in the HttpRequest::setRequestType.
      */
@@ -81,6 +111,32 @@ public:
         UNKNOWN,
     };
 
+    /**
+     * How the failed attempts of a request are sent again, see HttpRequest::setRetryPolicy.
+     * The n-th retry waits a random delay in [0, min(backoffCap, backoffBase * 2^(n-1))] milliseconds (full jitter),
+     * or the Retry-After of the server if it's longer.
+     */
+    struct RetryPolicy
+    {
+        struct ErrorClass
+        {
+            enum
+            {
+                CONNECT = 1,       /// resolving, connecting or the tls handshake failed
+                RESET   = 1 << 1,  /// the connection was reset or closed before the response was complete
+                TIMEOUT = 1 << 2,  /// the connect, idle or total timeout
+            };
+        };
+
+        int maxAttempts   = 1;      /// the attempts including the first one, 1 to never retry
+        int backoffBase   = 200;    /// milliseconds
+        int backoffCap    = 5000;   /// milliseconds
+        int maxRetryAfter = 30000;  /// milliseconds, the response is delivered if the server asks to wait longer
+        int errorClasses  = ErrorClass::CONNECT | ErrorClass::RESET | ErrorClass::TIMEOUT;
+        std::vector<int> statusCodes{408, 429, 500, 502, 503, 504};
+        bool idempotent = false;    /// marks a POST safe to send again, GET, PUT and DELETE always are
+    };
+
     /**
      *  Constructor.
      *   Because HttpRequest object will be used between UI thread and network thread,
@@ -144,15 +200,103 @@ public:
      * @param buffer the buffer of request data, it support binary data.
      * @param len    the size of request data.
      */
-    void setRequestData(const char* buffer, size_t len) { _requestData.assign(buffer, buffer + len); }
+    void setRequestData(const char* buffer, size_t len)
+    {
+        resetRequestData();
+        _requestData.assign(buffer, buffer + len);
+    }
+
+    /**
+     * Set the request data of HttpRequest object by taking over the buffer, no copy is made.
+     *
+     * @param buffer the buffer of request data, it support binary data.
+     */
+    void setRequestData(yasio::sbyte_buffer&& buffer)
+    {
+        resetRequestData();
+        _requestData = std::move(buffer);
+    }
+
+    /**
+     * Set the request data of HttpRequest object shared with other owners, no copy is made.
+     * The buffer must not be modified until the response callback is invoked.
+     *
+     * @param buffer the buffer of request data, it support binary data.
+     */
+    void setRequestData(std::shared_ptr<const yasio::sbyte_buffer> buffer)
+    {
+        resetRequestData();
+        _sharedRequestData = std::move(buffer);
+    }
+
+    /**
+     * Set the request data of HttpRequest object borrowed from the caller, no copy is made.
+     * The buffer must stay alive and unmodified until the response callback is invoked.
+     *
+     * @param buffer the buffer of request data, it support binary data.
+     * @param len    the size of request data.
+     */
+    void setRequestDataView(const char* buffer, size_t len)
+    {
+        resetRequestData();
+        _requestDataView.data = buffer;
+        _requestDataView.size = len;
+    }
+
+    /**
+     * Send a region of a file as the request data, the file is streamed by the network thread when the
+     * connection is established, so it's never loaded into memory at once.
+     *
+     * @param path   the full path of the file.
+     * @param offset the offset of the region in the file.
+     * @param length the length of the region, -1 to send the rest of the file.
+     */
+    void setRequestDataFromFile(std::string_view path, int64_t offset = 0, int64_t length = -1)
+    {
+        resetRequestData();
+        _requestFile.path   = path;
+        _requestFile.offset = offset;
+        _requestFile.length = length;
+    }
+
+    /**
+     * Stream the request data from a pull callback, the upload starts before the body is fully built.
+     * The data is sent with "Transfer-Encoding: chunked" if the size is unknown.
+     * Because the data can't be replayed, redirects which keep the request method aren't followed.
+     *
+     * @param producer the callback invoked on the network thread to fill the next chunk.
+     * @param size     the total size of request data, -1 if unknown.
+     */
+    void setRequestDataProducer(ccHttpRequestDataProducer producer, int64_t size = -1)
+    {
+        resetRequestData();
+        _requestDataProducer     = std::move(producer);
+        _requestDataProducerSize = size;
+    }
+
+    const ccHttpRequestDataProducer& getRequestDataProducer() const { return _requestDataProducer; }
+
+    int64_t getRequestDataProducerSize() const { return _requestDataProducerSize; }
+
+    /**
+     * Check whether the request data is streamed from a file or a producer.
+     */
+    bool isRequestDataStreamed() const { return !_requestFile.path.empty() || _requestDataProducer != nullptr; }
 
     /**
      * Get the request data pointer of HttpRequest object.
+     * Don't modify the data if it's set by a shared buffer, and it's always nullptr if the data is streamed.
      *
      * @return char* the request data pointer.
      */
     char* getRequestData()
     {
+        if (_sharedRequestData)
+            return !_sharedRequestData->empty() ? const_cast<char*>(_sharedRequestData->data()) : nullptr;
+
+        if (_requestDataView.size > 0)
+            return const_cast<char*>(_requestDataView.data);
+
         if (!_requestData.empty())
             return _requestData.data();
 
@@ -160,11 +304,27 @@ public:
     }
 
     /**
-     * Get the size of request data
+     * Get the size of request data, it's always 0 if the data is streamed.
      *
      * @return ssize_t the size of request data
      */
-    ssize_t getRequestDataSize() const { return _requestData.size(); }
+    ssize_t getRequestDataSize() const
+    {
+        if (_sharedRequestData)
+            return _sharedRequestData->size();
+        return _requestDataView.data ? _requestDataView.size : _requestData.size();
+    }
+
+    /**
+     * Get the file path of request data.
+     *
+     * @return std::string_view the file path, empty if the data isn't from a file.
+     */
+    std::string_view getRequestFilePath() const { return _requestFile.path; }
+
+    int64_t getRequestFileOffset() const { return _requestFile.offset; }
+
+    int64_t getRequestFileLength() const { return _requestFile.length; }
 
     /**
      * Set a string tag to identify your request.
@@ -182,6 +342,16 @@ public:
      */
     std::string_view getTag() const { return _tag; }
 
+    /**
+     * Set the priority of the response callback, when many responses are finished together the callbacks
+     * of higher priority are dispatched first, see HttpClient::setDispatchTimeBudget.
+     *
+     * @param priority the priority, 0 by default.
+     */
+    void setPriority(int priority) { _priority = priority; }
+
+    int getPriority() const { return _priority; }
+
     /**
      * Set user-customed data of HttpRequest object.
      * You can attach a customed data in each request, and get it back in response callback.
@@ -209,6 +379,26 @@ public:
 
 
     const ccHttpRequestCallback& getCallback() const { return _pCallback; }
+
+    /**
+     * Set a plain response handler, it's invoked in place of the response callback.
+     *
+     * @param handler the ccHttpResponseHandler function, nullptr to use the response callback.
+     */
+    void setResponseHandler(ccHttpResponseHandler handler) { _responseHandler = handler; }
+
+    ccHttpResponseHandler getResponseHandler() const { return _responseHandler; }
+
+    /**
+     * Set the upload progress callback of HttpRequest object.
+     * It's invoked on the game thread as the request data is written to the socket, at most once every
+     * HttpClient::UPLOAD_PROGRESS_INTERVAL milliseconds, the last progress is always reported.
+     *
+     * @param callback the ccHttpUploadProgressCallback function.
+     */
+    void setUploadProgressCallback(const ccHttpUploadProgressCallback& callback) { _uploadProgressCallback = callback; }
+
+    const ccHttpUploadProgressCallback& getUploadProgressCallback() const { return _uploadProgressCallback; }
     /**
      * Set custom-defined headers.
      *
@@ -223,25 +413,75 @@ public:
      */
     const std::vector<std::string>& getHeaders() const { return _headers; }
 
+    /**
+     * Set a pre-serialized header block shared by many requests, see HttpClient::registerHeaderTemplate.
+     * Headers set with setHeaders are still sent, after the template.
+     *
+     * @param headerTemplate the template, nullptr to serialize the custom headers only.
+     */
+    void setHeaderTemplate(HttpHeaderTemplatePtr headerTemplate) { _headerTemplate = std::move(headerTemplate); }
+
+    /**
+     * Get the pre-serialized header block.
+     *
+     * @return HttpHeaderTemplatePtr the template, or nullptr if not set.
+     */
+    const HttpHeaderTemplatePtr& getHeaderTemplate() const { return _headerTemplate; }
+
+    /**
+     * Set the idle timeout of the request, it fails when no byte was received or written for so long.
+     *
+     * @param value the timeout in milliseconds, 0 to disable, -1 (the default) to use HttpClient::getTimeoutForRead.
+     */
+    void setTimeoutForIdle(int value) { _timeoutForIdle = value; }
+
+    int getTimeoutForIdle() const { return _timeoutForIdle; }
+
+    /**
+     * Set the max time the request may take from being sent until the response is complete.
+     *
+     * @param value the timeout in milliseconds, 0 for no limit, -1 (the default) to use HttpClient::getTimeoutForTotal.
+     */
+    void setTimeoutForTotal(int value) { _timeoutForTotal = value; }
+
+    int getTimeoutForTotal() const { return _timeoutForTotal; }
+
+    /**
+     * Set the retry policy, the request isn't retried by default.
+     * A request with a streamed producer body is never retried, because the data was consumed.
+     *
+     * @param policy the retry policy.
+     */
+    void setRetryPolicy(const RetryPolicy& policy) { _retryPolicy = policy; }
+
+    const RetryPolicy& getRetryPolicy() const { return _retryPolicy; }
+
+    /**
+     * Enable hedging for a small GET whose tail latency matters: when the response headers are later than
+     * the p95 of the host, an identical request is sent on another channel, the first response wins and
+     * the other is cancelled. See HttpClient::setHedgingBudget.
+     *
+     * @param enabled whether hedge the request, false by default.
+     */
+    void setHedging(bool enabled) { _hedging = enabled; }
+
+    bool isHedgingEnabled() const { return _hedging; }
+
     void setHosts(std::vector<std::string> hosts) { _hosts = std::move(hosts); }
     const std::vector<std::string>& getHosts() const { return _hosts; }
 
 private:
-    void setSync(bool sync)
+    void resetRequestData()
     {
-        if (sync)
-            _syncState = std::make_shared<std::promise<HttpResponse*>>();
-        else
-            _syncState.reset();
-    }
-
-    std::shared_ptr<std::promise<HttpResponse*>> getSyncState() { return _syncState; }
-
-    HttpResponse* wait()
-    {
-        if (_syncState)
-            return _syncState->get_future().get();
-        return nullptr;
+        _requestData.clear();
+        _sharedRequestData.reset();
+        _requestDataView.data = nullptr;
+        _requestDataView.size = 0;
+        _requestFile.path.clear();
+        _requestFile.offset = 0;
+        _requestFile.length = -1;
+        _requestDataProducer     = nullptr;
+        _requestDataProducerSize = -1;
     }
 
 protected:
@@ -249,13 +489,33 @@ protected:
     Type _requestType;                  /// kHttpRequestGet, kHttpRequestPost or other enums
     std::string _url;                   /// target url that this request is sent to
     yasio::sbyte_buffer _requestData;   /// used for POST
+    std::shared_ptr<const yasio::sbyte_buffer> _sharedRequestData;  /// used for POST, shared with the caller
+    struct
+    {
+        const char* data = nullptr;
+        size_t size      = 0;
+    } _requestDataView;                 /// used for POST, borrowed from the caller
+    struct
+    {
+        std::string path;
+        int64_t offset = 0;
+        int64_t length = -1;
+    } _requestFile;                     /// used for POST, the file region to send
+    ccHttpRequestDataProducer _requestDataProducer;  /// used for POST, the streamed request data
+    int64_t _requestDataProducerSize = -1;
     std::string _tag;                   /// user defined tag, to identify different requests in response callback
     ccHttpRequestCallback _pCallback;   /// C++11 style callbacks
+    ccHttpResponseHandler _responseHandler = nullptr;  /// plain function used in place of _pCallback
+    ccHttpUploadProgressCallback _uploadProgressCallback;  /// reports the bytes of request data written
     void* _pUserData;                   /// You can add your customed data here
     std::vector<std::string> _headers;  /// custom http headers
     std::vector<std::string> _hosts;
-   
-    std::shared_ptr<std::promise<HttpResponse*>> _syncState;
+    HttpHeaderTemplatePtr _headerTemplate;  /// pre-serialized http headers
+    int _timeoutForIdle  = -1;          /// milliseconds, -1 to use the HttpClient one
+    int _timeoutForTotal = -1;          /// milliseconds, -1 to use the HttpClient one
+    RetryPolicy _retryPolicy;
+    bool _hedging = false;
+    int _priority = 0;
 };
 
 }  // namespace network
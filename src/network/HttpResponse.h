@@ -33,6 +33,7 @@
 #include "HttpRequest.h"
 #include "Uri.h"
 #include "llhttp.h"
+#include "yasio_fwd.hpp"
 
 /**
  * @addtogroup network
@@ -56,6 +57,12 @@ class HttpResponse : public Ref
 public:
     using ResponseHeaderMap = std::multimap<std::string, std::string>;
 
+    /**
+     * Called on the network thread with the finished response instead of the response callback,
+     * it takes over the reference of the response, see HttpClient::sendWithCompletionHook.
+     */
+    typedef void (*CompletionHook)(void* context, HttpResponse* response);
+
     /**
      * Constructor, it's used by HttpClient internal, users don't need to create HttpResponse manually.
      * @param request the corresponding HttpRequest which leads to this response.
@@ -125,9 +132,29 @@ public:
 
     int getRedirectCount() const { return _redirectCount; }
 
+    /**
+     * Get how many times the request was sent, more than 1 if it was retried, see HttpRequest::setRetryPolicy.
+     */
+    int getAttemptCount() const { return _attemptCount; }
+
     const ResponseHeaderMap& getResponseHeaders() const { return _responseHeaders; }
 
 private:
+    /**
+     * The state shared by the waiter and the network thread of a response sent with a future.
+     */
+    struct SyncState
+    {
+        enum
+        {
+            PENDING,
+            FINISHED,
+            ABANDONED,  /// the waiter gave up, the network thread releases the response
+        };
+        std::promise<HttpResponse*> promise;
+        std::atomic<int> status{PENDING};
+    };
+
     void updateInternalCode(int value)
     {
         if (_internalCode == 0)
@@ -158,6 +185,11 @@ private:
                 auto redirectUrl = iter->second;
                 if (_responseCode == 302)
                     getHttpRequest()->setRequestType(network::HttpRequest::Type::GET);
+                // the data of producer was consumed already and can't be sent again
+                auto requestType = getHttpRequest()->getRequestType();
+                if (getHttpRequest()->getRequestDataProducer() && (requestType == network::HttpRequest::Type::POST ||
+                                                                    requestType == network::HttpRequest::Type::PUT))
+                    return false;
                 AXLOG("Process url redirect (%d): %s", _responseCode, redirectUrl.c_str());
                 return setLocation(redirectUrl, true);
             }
@@ -184,38 +216,54 @@ private:
             if (!uri.isValid())
                 return false;
             _requestUri = std::move(uri);
-
-            /* Resets response status */
-            _responseHeaders.clear();
-            _finished = false;
-            _responseData.clear();
-            _currentHeader.clear();
-            _responseCode = -1;
-            _internalCode = 0;
-
-            /* Initialize user callbacks and settings */
-            llhttp_settings_init(&_contextSettings);
-
-            /* Initialize the parser in HTTP_BOTH mode, meaning that it will select between
-             * HTTP_REQUEST and HTTP_RESPONSE parsing automatically while reading the first
-             * input.
-             */
-            llhttp_init(&_context, HTTP_RESPONSE, &_contextSettings);
-
-            _context.data = this;
-
-            /* Set user callbacks */
-            _contextSettings.on_header_field          = on_header_field;
-            _contextSettings.on_header_field_complete = on_header_field_complete;
-            _contextSettings.on_header_value          = on_header_value;
-            _contextSettings.on_header_value_complete = on_header_value_complete;
-            _contextSettings.on_body                  = on_body;
-            _contextSettings.on_message_complete      = on_complete;
+            reset();
         }
 
         return true;
     }
 
+    /**
+     * Reset the response to send the request to the same location again.
+     */
+    void prepareRetry()
+    {
+        ++_attemptCount;
+        reset();
+    }
+
+    void reset()
+    {
+        /* Resets response status */
+        _responseHeaders.clear();
+        _finished = false;
+        _responseData.clear();
+        _currentHeader.clear();
+        _currentHeaderValue.clear();
+        _headersComplete = false;
+        _responseCode = -1;
+        _internalCode = 0;
+
+        /* Initialize user callbacks and settings */
+        llhttp_settings_init(&_contextSettings);
+
+        /* Initialize the parser in HTTP_BOTH mode, meaning that it will select between
+         * HTTP_REQUEST and HTTP_RESPONSE parsing automatically while reading the first
+         * input.
+         */
+        llhttp_init(&_context, HTTP_RESPONSE, &_contextSettings);
+
+        _context.data = this;
+
+        /* Set user callbacks */
+        _contextSettings.on_header_field          = on_header_field;
+        _contextSettings.on_header_field_complete = on_header_field_complete;
+        _contextSettings.on_header_value          = on_header_value;
+        _contextSettings.on_header_value_complete = on_header_value_complete;
+        _contextSettings.on_headers_complete      = on_headers_complete;
+        _contextSettings.on_body                  = on_body;
+        _contextSettings.on_message_complete      = on_complete;
+    }
+
     bool validateUri() const { return _requestUri.isValid(); }
 
     const Uri& getRequestUri() const { return _requestUri; }
@@ -245,6 +293,15 @@ private:
         thiz->_responseHeaders.emplace(std::move(thiz->_currentHeader), std::move(thiz->_currentHeaderValue));
         return 0;
     }
+    static int on_headers_complete(llhttp_t* context)
+    {
+        // Reserve the whole body up front when the size is known, so on_body never moves the received bytes
+        auto thiz              = (HttpResponse*)context->data;
+        thiz->_headersComplete = true;
+        if ((context->flags & F_CONTENT_LENGTH) && context->content_length <= MAX_RESERVE_BODY_SIZE)
+            thiz->_responseData.reserve(thiz->_responseData.size() + static_cast<size_t>(context->content_length));
+        return 0;
+    }
     static int on_body(llhttp_t* context, const char* at, size_t length)
     {
         auto thiz = (HttpResponse*)context->data;
@@ -260,20 +317,60 @@ private:
     }
 
 protected:
+    static constexpr uint64_t MAX_RESERVE_BODY_SIZE = 32 * 1024 * 1024;
+
     // properties
     HttpRequest* _pHttpRequest;  /// the corresponding HttpRequest pointer who leads to this response
     int _redirectCount = 0;
+    int _attemptCount  = 1;
 
     Uri _requestUri;
+    std::shared_ptr<SyncState> _syncState;  /// only set for the responses sent with a future, per send
+    CompletionHook _completionHook = nullptr;  /// only set for the responses sent with a hook, per send
+    void* _completionHookContext   = nullptr;
     bool _finished = false;             /// to indicate if the http request is successful simply
     yasio::sbyte_buffer _responseData;  /// the returned raw data. You can also dump it as a string
     std::string _currentHeader;
     std::string _currentHeaderValue;
+    bool _headersComplete = false;
     ResponseHeaderMap _responseHeaders;  /// the returned raw header data. You can also dump it as a string
     int _responseCode = -1;              /// the status code returned from server, e.g. 200, 404
     int _internalCode = 0;               /// the ret code of perform
     llhttp_t _context;
     llhttp_settings_t _contextSettings;
+    long long _lastActivityTime = 0;     /// the time of last bytes received or written in milliseconds
+    long long _sendTime         = 0;     /// the time the request was sent in milliseconds
+
+    struct
+    {
+        long long createTime = 0;      /// microseconds, when the request was sent to HttpClient
+        long long openTime   = 0;      /// microseconds, when the channel was opened, 0 once connected
+        long long sendTime   = 0;      /// microseconds, when the request of current connection was written
+        bool queueRecorded   = false;  /// the wait for the first channel was recorded
+        bool firstByte       = false;  /// a byte of current connection was received
+        uint64_t bytesIn     = 0;      /// all attempts and redirects included
+        uint64_t bytesOut    = 0;
+    } _stats;                          /// recorded to HttpMetrics
+
+    struct
+    {
+        ccHttpRequestDataProducer producer;  /// the streamed request data of current connection
+        int64_t size        = -1;            /// the total size, -1 if unknown
+        int64_t bytesQueued = 0;             /// the bytes produced and queued to the transport
+        bool chunked        = false;
+        long long lastProgressTime = 0;      /// the time of last reported upload progress in milliseconds
+        std::shared_ptr<yasio::highp_timer> pendingTimer;  /// polls the producer when no data is ready
+    } _upload;
+
+    struct
+    {
+        HttpResponse* peer  = nullptr;  /// the other attempt of a hedged request, until one of them wins
+        int peerChannel     = -1;
+        bool lost           = false;    /// the peer won, the response is discarded when its channel closes
+        bool hedged         = false;    /// a hedge was sent for the response, or it's the hedge itself
+        bool isHedge        = false;
+        std::shared_ptr<yasio::highp_timer> timer;  /// sends the hedge when the headers are late
+    } _hedge;
 };
 
 } 
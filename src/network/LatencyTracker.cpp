@@ -0,0 +1,65 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#include "LatencyTracker.h"
+#include <algorithm>
+
+namespace network
+{
+
+void LatencyTracker::record(std::string_view host, int latency)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    auto it = _hosts.find(std::string{host});
+    if (it == _hosts.end())
+        it = _hosts.emplace(std::string{host}, Samples{}).first;
+    auto& samples = it->second;
+    samples.values[samples.count++ % MAX_SAMPLES] = latency;
+}
+
+int LatencyTracker::getPercentile(std::string_view host, int percentile)
+{
+    int values[MAX_SAMPLES];
+    int count = 0;
+    {
+        std::lock_guard<std::mutex> lck(_mutex);
+        auto it = _hosts.find(std::string{host});
+        if (it == _hosts.end() || it->second.count < MIN_SAMPLES)
+            return -1;
+        count = (std::min)(it->second.count, MAX_SAMPLES);
+        std::copy_n(it->second.values, count, values);
+    }
+
+    int rank = (std::max)((count * percentile + 99) / 100 - 1, 0);  // nearest rank
+    std::nth_element(values, values + rank, values + count);
+    return values[rank];
+}
+
+void LatencyTracker::clear()
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    _hosts.clear();
+}
+
+}  // namespace network
@@ -0,0 +1,94 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef __HTTP_LATENCY_TRACKER_H__
+#define __HTTP_LATENCY_TRACKER_H__
+
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * @addtogroup network
+ * @{
+ */
+
+namespace network
+{
+
+/**
+ * Tracks the time to response headers of the latest requests per host, HttpClient uses its p95
+ * to decide when a hedged request is late.
+ *
+ * @lua NA
+ */
+class LatencyTracker
+{
+public:
+    /**
+     * How many latest samples are kept per host.
+     */
+    static constexpr int MAX_SAMPLES = 64;
+
+    /**
+     * How many samples a host needs before its percentiles are reported.
+     */
+    static constexpr int MIN_SAMPLES = 16;
+
+    /**
+     * Add the milliseconds a request to the host took to receive the response headers.
+     */
+    void record(std::string_view host, int latency);
+
+    /**
+     * Get the latency percentile of the host.
+     *
+     * @param percentile in (0, 100], such as 95.
+     * @return the latency in milliseconds, or -1 if the host has too few samples.
+     */
+    int getPercentile(std::string_view host, int percentile);
+
+    /**
+     * Drop all samples, such as when the network changed.
+     */
+    void clear();
+
+private:
+    struct Samples
+    {
+        int values[MAX_SAMPLES];
+        int count = 0;  // the total samples recorded, the latest MAX_SAMPLES are kept
+    };
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, Samples> _hosts;
+};
+
+}  // namespace network
+
+// end group
+/// @}
+
+#endif  //__HTTP_LATENCY_TRACKER_H__
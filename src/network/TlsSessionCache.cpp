@@ -0,0 +1,83 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#include "TlsSessionCache.h"
+
+namespace network
+{
+
+std::string TlsSessionCache::load(const char* host)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    auto it = _sessions.find(host);
+    return it != _sessions.end() ? it->second.session : std::string{};
+}
+
+void TlsSessionCache::save(const char* host, std::string session)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    _sessions[host] = Record{host, std::move(session), std::chrono::system_clock::now()};
+}
+
+void TlsSessionCache::recordHandshake(bool resumed)
+{
+    ++_handshakes;
+    if (resumed)
+        ++_resumed;
+}
+
+float TlsSessionCache::getResumptionRate() const
+{
+    auto handshakes = _handshakes.load();
+    return handshakes != 0 ? static_cast<float>(_resumed.load()) / handshakes : 0.0f;
+}
+
+std::vector<TlsSessionCache::Record> TlsSessionCache::getRecords(int maxAge)
+{
+    std::vector<Record> records;
+
+    std::lock_guard<std::mutex> lck(_mutex);
+    auto oldest = std::chrono::system_clock::now() - std::chrono::seconds(maxAge);
+    for (auto&& item : _sessions)
+    {
+        if (item.second.saveTime >= oldest)
+            records.push_back(item.second);
+    }
+    return records;
+}
+
+void TlsSessionCache::addRecords(const std::vector<Record>& records)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    for (auto&& record : records)
+        _sessions.emplace(record.host, record);  // keep the newer sessions
+}
+
+void TlsSessionCache::clear()
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    _sessions.clear();
+}
+
+}  // namespace network
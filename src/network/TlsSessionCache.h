@@ -0,0 +1,124 @@
+/****************************************************************************
+ Copyright (c) 2021 Bytedance Inc.
+
+ https://axmolengine.github.io/
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ ****************************************************************************/
+
+#ifndef __HTTP_TLS_SESSION_CACHE_H__
+#define __HTTP_TLS_SESSION_CACHE_H__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <chrono>
+
+/**
+ * @addtogroup network
+ * @{
+ */
+
+namespace network
+{
+
+/**
+ * A host-keyed cache of TLS client sessions, offered to every new SSL connection of HttpClient
+ * so that reconnections resume the session with an abbreviated handshake.
+ *
+ * Sessions are opaque serialized blobs, see yssl_get_session.
+ *
+ * @lua NA
+ */
+class TlsSessionCache
+{
+public:
+    struct Record
+    {
+        std::string host;
+        std::string session;
+        std::chrono::system_clock::time_point saveTime;
+    };
+
+    static constexpr int MAX_PERSISTED_AGE = 24 * 60 * 60;  // in seconds, see getRecords
+
+    TlsSessionCache() : _handshakes(0), _resumed(0) {}
+
+    /**
+     * Get the session saved for the host, empty if none.
+     */
+    std::string load(const char* host);
+
+    /**
+     * Save the latest resumable session of the host.
+     */
+    void save(const char* host, std::string session);
+
+    /**
+     * Count an established TLS connection for the resumption hit rate.
+     */
+    void recordHandshake(bool resumed);
+
+    /**
+     * Get the number of established TLS connections.
+     */
+    unsigned long long getHandshakeCount() const { return _handshakes; }
+
+    /**
+     * Get the number of established TLS connections which resumed a session.
+     */
+    unsigned long long getResumedCount() const { return _resumed; }
+
+    /**
+     * Get the ratio of resumed handshakes, 0 if no connection established yet.
+     */
+    float getResumptionRate() const;
+
+    /**
+     * Get the cached sessions saved within maxAge seconds, such as to persist them.
+     * The sessions hold the resumption secrets, persist only the ones the servers are still likely to accept.
+     */
+    std::vector<Record> getRecords(int maxAge = MAX_PERSISTED_AGE);
+
+    /**
+     * Add sessions saved before, such as by the last launch.
+     */
+    void addRecords(const std::vector<Record>& records);
+
+    /**
+     * Drop all cached sessions.
+     */
+    void clear();
+
+private:
+    std::mutex _mutex;
+    std::unordered_map<std::string, Record> _sessions;  // by host
+
+    std::atomic<unsigned long long> _handshakes;
+    std::atomic<unsigned long long> _resumed;
+};
+
+}  // namespace network
+
+// end group
+/// @}
+
+#endif  //__HTTP_TLS_SESSION_CACHE_H__
@@ -0,0 +1,216 @@
+// Awaits HttpClient::fetch against a local HTTP server. It builds the coroutine API of HttpAwaitable.h,
+// which needs C++20, and checks that:
+//
+// - a fetch resumed on the game thread is resumed by Scheduler::update, like in a frame
+// - a fetch resumed on the network thread can send a dependent fetch from there
+// - concurrent fetches of the same request each resume their own coroutine with their own response
+// - the response callback of a fetched request is not invoked
+//
+// usage: fetch_awaitable, it exits with 1 if a check failed
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "network/HttpClient.h"
+#include "network/HttpAwaitable.h"
+#include "base/Director.h"
+#include "yasio.hpp"
+
+using namespace network;
+
+static std::atomic<int> failures{0};  // the checks run on the network thread too
+
+static void check(bool ok, const char* what)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+static std::string bodyOf(HttpResponse* response)
+{
+    auto data = response->getResponseData();
+    return std::string(data->begin(), data->end());
+}
+
+// answers every request with its path as the body, one request per connection
+class EchoServer
+{
+public:
+    EchoServer()
+    {
+        _socket.open(AF_INET, SOCK_STREAM);
+        _socket.set_optval(SOL_SOCKET, SO_REUSEADDR, 1);
+        _socket.bind("127.0.0.1", 0);
+        _socket.listen();
+        _port   = _socket.local_endpoint().port();
+        _thread = std::thread([this] { run(); });
+    }
+
+    ~EchoServer()
+    {
+        _stopped = true;
+        yasio::xxsocket wakeup;
+        wakeup.pconnect("127.0.0.1", _port);
+        _thread.join();
+    }
+
+    std::string url(const char* path) const { return "http://127.0.0.1:" + std::to_string(_port) + path; }
+
+private:
+    void run()
+    {
+        while (!_stopped)
+        {
+            auto client = _socket.accept();
+            if (!client.is_open() || _stopped)
+                continue;
+
+            std::string request;
+            char buf[1024];
+            while (request.find("\r\n\r\n") == std::string::npos)
+            {
+                int n = client.recv(buf, sizeof(buf));
+                if (n <= 0)
+                    break;
+                request.append(buf, n);
+            }
+
+            // GET <path> HTTP/1.1
+            auto begin = request.find(' ') + 1;
+            auto path  = request.substr(begin, request.find(' ', begin) - begin);
+            auto reply = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(path.size()) +
+                         "\r\nConnection: close\r\n\r\n" + path;
+            client.send(reply.data(), static_cast<int>(reply.size()));
+            client.shutdown();
+        }
+    }
+
+    yasio::xxsocket _socket;
+    unsigned short _port = 0;
+    std::atomic<bool> _stopped{false};
+    std::thread _thread;
+};
+
+// plays the game thread, the responses and the coroutines resumed on it run in Scheduler::update
+static void runFrames(const std::atomic<int>& done, int expected)
+{
+    auto scheduler = Director::getInstance()->getScheduler();
+    auto deadline  = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (done < expected && std::chrono::steady_clock::now() < deadline)
+    {
+        scheduler->update(1.0f / 60);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    check(done == expected, "the awaiting coroutines were resumed in time");
+}
+
+static HttpRequest* newRequest(const std::string& url, std::atomic<int>& callbacks)
+{
+    auto request = new HttpRequest();
+    request->setRequestType(HttpRequest::Type::GET);
+    request->setUrl(url);
+    request->setResponseCallback([&callbacks](HttpClient*, HttpResponse*) { ++callbacks; });
+    return request;
+}
+
+static HttpTask fetchOnGameThread(HttpClient* client, HttpRequest* request, std::thread::id gameThread,
+                                  std::atomic<int>& done)
+{
+    {
+        auto response = co_await client->fetch(request);
+        check(std::this_thread::get_id() == gameThread, "GAME_THREAD resumes on the thread of Scheduler::update");
+        check(response && response->getResponseCode() == 200, "GAME_THREAD fetch succeeded");
+        check(response && bodyOf(response.get()) == "/game", "GAME_THREAD fetch got its body");
+    }
+    ++done;
+}
+
+static HttpTask fetchDependent(HttpClient* client, HttpRequest* first, HttpRequest* second, std::atomic<int>& done)
+{
+    {
+        auto response = co_await client->fetch(first, HttpResumeOn::NETWORK_THREAD);
+        check(response && bodyOf(response.get()) == "/first", "NETWORK_THREAD fetch got its body");
+
+        // sent from the network thread
+        auto dependent = co_await client->fetch(second, HttpResumeOn::NETWORK_THREAD);
+        check(dependent && bodyOf(dependent.get()) == "/second", "dependent fetch got its body");
+    }
+    ++done;  // Ref isn't thread safe, the responses are released before the game thread goes on
+}
+
+static HttpTask fetchShared(HttpClient* client, HttpRequest* request, std::mutex& mutex,
+                            std::vector<RefPtr<HttpResponse>>& responses, std::atomic<int>& done)
+{
+    {
+        auto response = co_await client->fetch(request, HttpResumeOn::NETWORK_THREAD);
+        check(response && bodyOf(response.get()) == "/same", "concurrent fetch of one request got its body");
+        std::lock_guard<std::mutex> lck(mutex);
+        responses.push_back(std::move(response));  // kept alive, so the responses can be told apart by address
+    }
+    ++done;
+}
+
+int main()
+{
+    EchoServer server;
+    auto client     = HttpClient::getInstance();
+    auto gameThread = std::this_thread::get_id();
+    std::atomic<int> callbacks{0};
+
+    {
+        std::atomic<int> done{0};
+        auto request = newRequest(server.url("/game"), callbacks);
+        fetchOnGameThread(client, request, gameThread, done);
+        runFrames(done, 1);
+        request->release();
+    }
+
+    {
+        std::atomic<int> done{0};
+        auto first  = newRequest(server.url("/first"), callbacks);
+        auto second = newRequest(server.url("/second"), callbacks);
+        fetchDependent(client, first, second, done);
+        runFrames(done, 1);
+        first->release();
+        second->release();
+    }
+
+    {
+        constexpr int FETCHES = 4;
+        std::atomic<int> done{0};
+        std::mutex mutex;
+        std::vector<RefPtr<HttpResponse>> responses;
+        auto request = newRequest(server.url("/same"), callbacks);
+        for (int i = 0; i < FETCHES; ++i)
+            fetchShared(client, request, mutex, responses, done);
+        runFrames(done, FETCHES);
+
+        std::lock_guard<std::mutex> lck(mutex);
+        std::set<HttpResponse*> distinct;
+        for (auto&& response : responses)
+            distinct.insert(response.get());
+        check(distinct.size() == FETCHES, "every concurrent fetch got its own response");
+        request->release();
+    }
+
+    // a few more frames, a response dispatched to the callback by mistake would be invoked in them
+    for (int frame = 0; frame < 10; ++frame)
+    {
+        Director::getInstance()->getScheduler()->update(1.0f / 60);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    check(callbacks == 0, "the response callback of a fetched request is not invoked");
+
+    HttpClient::destroyInstance();
+
+    printf(failures ? "%d check(s) failed\n" : "all checks passed\n", failures.load());
+    return failures ? 1 : 0;
+}